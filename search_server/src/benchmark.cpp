@@ -0,0 +1,301 @@
+// Нагрузочные замеры поискового сервера. Результаты печатаются в CSV:
+// benchmark,corpus_size,operations,ops_per_sec,p50_us,p90_us,p99_us,peak_rss_kb
+//
+// Параметры:
+//   --sizes 1000,10000     размеры корпуса
+//   --queries 200          число запросов в замерах поиска
+//   --threads 0            число потоков сервера, 0 — по числу ядер
+//   --baseline file.csv    сравнить с прошлым запуском и завершиться с кодом 1 при регрессии
+//   --max-regression 0.25  допустимое падение ops_per_sec относительно baseline
+
+#include "generators.h"
+#include "process_queries.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <execution>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct Options {
+    vector<size_t> corpus_sizes = {1000, 10000};
+    int query_count = 200;
+    size_t concurrency = 0;
+    string baseline_path;
+    double max_regression = 0.25;
+};
+
+struct Measurement {
+    string benchmark;
+    size_t corpus_size = 0;
+    size_t operation_count = 0;
+    double seconds = 0;
+    // длительность каждого замеренного вызова
+    vector<double> latencies_us;
+
+    double GetOpsPerSecond() const {
+        return seconds > 0 ? operation_count / seconds : 0;
+    }
+};
+
+long GetPeakRssKb() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+double GetPercentile(vector<double> values, double percentile) {
+    if (values.empty())
+        return 0;
+
+    const size_t index = min(values.size() - 1, static_cast<size_t>(percentile * values.size()));
+    nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+// Замеряет operation(i) для i из [0, call_count); каждый вызов выполняет operations_per_call операций
+template<typename Operation>
+Measurement Measure(string benchmark, size_t corpus_size, size_t call_count, size_t operations_per_call,
+                    Operation operation) {
+    Measurement measurement{move(benchmark), corpus_size, call_count * operations_per_call, 0, {}};
+    measurement.latencies_us.reserve(call_count);
+
+    const auto start = Clock::now();
+    for (size_t i = 0; i < call_count; ++i) {
+        const auto call_start = Clock::now();
+        operation(i);
+        measurement.latencies_us.push_back(
+            chrono::duration<double, micro>(Clock::now() - call_start).count() / operations_per_call);
+    }
+    measurement.seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    return measurement;
+}
+
+void PrintHeader(ostream& out) {
+    out << "benchmark,corpus_size,operations,ops_per_sec,p50_us,p90_us,p99_us,peak_rss_kb"s << endl;
+}
+
+void PrintMeasurement(ostream& out, const Measurement& measurement) {
+    out << measurement.benchmark << ','
+        << measurement.corpus_size << ','
+        << measurement.operation_count << ','
+        << measurement.GetOpsPerSecond() << ','
+        << GetPercentile(measurement.latencies_us, 0.5) << ','
+        << GetPercentile(measurement.latencies_us, 0.9) << ','
+        << GetPercentile(measurement.latencies_us, 0.99) << ','
+        << GetPeakRssKb() << endl;
+}
+
+vector<Measurement> RunBenchmarks(size_t corpus_size, const Options& options) {
+    mt19937 generator(static_cast<unsigned>(corpus_size));
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto texts = GenerateQueries(generator, dictionary, corpus_size, 70);
+    const auto queries = GenerateQueries(generator, dictionary, options.query_count, 10, 0.1);
+    // длинные запросы, как в демонстрации main.cpp: почти каждый документ содержит какое-нибудь их слово
+    const auto long_queries = GenerateQueries(generator, dictionary, options.query_count, 70);
+    const vector<int> ratings = {1, 2, 3};
+
+    vector<Measurement> measurements;
+
+    SearchServer search_server(dictionary[0], options.concurrency);
+    measurements.push_back(Measure("add_document"s, corpus_size, corpus_size, 1, [&](size_t i) {
+        search_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, ratings);
+    }));
+
+    vector<NewDocument> batch;
+    batch.reserve(corpus_size);
+    for (size_t i = 0; i < corpus_size; ++i) {
+        batch.push_back({static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, ratings});
+    }
+    // сервер и его пул потоков создаются до замера, чтобы замерялось только добавление
+    SearchServer batch_server(dictionary[0], options.concurrency);
+    measurements.push_back(Measure("add_documents_par"s, corpus_size, 1, corpus_size, [&](size_t) {
+        batch_server.AddDocuments(execution::par, batch);
+    }));
+
+    // замеры поиска считают каждый запрос заново; кеш результатов замеряется отдельно
+    search_server.SetResultCacheCapacity(0);
+    double total_relevance = 0;
+    measurements.push_back(Measure("find_top_documents_seq"s, corpus_size, queries.size(), 1, [&](size_t i) {
+        for (const Document& document : search_server.FindTopDocuments(execution::seq, queries[i])) {
+            total_relevance += document.relevance;
+        }
+    }));
+    measurements.push_back(Measure("find_top_documents_par"s, corpus_size, queries.size(), 1, [&](size_t i) {
+        for (const Document& document : search_server.FindTopDocuments(execution::par, queries[i])) {
+            total_relevance += document.relevance;
+        }
+    }));
+
+    measurements.push_back(Measure("find_top_documents_long_query"s, corpus_size, long_queries.size(), 1, [&](size_t i) {
+        for (const Document& document : search_server.FindTopDocuments(execution::seq, long_queries[i])) {
+            total_relevance += document.relevance;
+        }
+    }));
+
+    // частоты запросов убывают как 1/ранг, как в живом потоке запросов
+    vector<double> query_weights(queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        query_weights[i] = 1.0 / (i + 1);
+    }
+    discrete_distribution<size_t> zipf_query(query_weights.begin(), query_weights.end());
+    search_server.SetResultCacheCapacity(DEFAULT_RESULT_CACHE_CAPACITY);
+    measurements.push_back(Measure("find_top_documents_zipf_cached"s, corpus_size, queries.size() * 4, 1, [&](size_t) {
+        for (const Document& document : search_server.FindTopDocuments(queries[zipf_query(generator)])) {
+            total_relevance += document.relevance;
+        }
+    }));
+
+    size_t matched_count = 0;
+    measurements.push_back(Measure("match_document"s, corpus_size, queries.size(), 1, [&](size_t i) {
+        const int document_id = static_cast<int>(generator() % corpus_size);
+        matched_count += get<0>(search_server.MatchDocument(queries[i], document_id)).size();
+    }));
+
+    measurements.push_back(Measure("process_queries"s, corpus_size, 1, queries.size(), [&](size_t) {
+        for (const auto& documents : ProcessQueries(search_server, queries)) {
+            matched_count += documents.size();
+        }
+    }));
+
+    // удаляются три четверти корпуса: удалённых становится больше, чем живых, но сжатие
+    // запускается отдельно и не попадает в задержку удаления
+    const size_t removed_count = corpus_size * 3 / 4;
+    measurements.push_back(Measure("remove_document"s, corpus_size, removed_count, 1, [&](size_t i) {
+        search_server.RemoveDocument(static_cast<int>(i));
+    }));
+    measurements.push_back(Measure("compact"s, corpus_size, 1, removed_count, [&](size_t) {
+        search_server.Compact(execution::par);
+    }));
+
+    // итоги не печатаются, но не дают компилятору выбросить замеряемую работу
+    if (total_relevance < 0 || matched_count == static_cast<size_t>(-1))
+        cerr << total_relevance << matched_count << endl;
+
+    return measurements;
+}
+
+map<pair<string, size_t>, double> ReadBaseline(const string& path) {
+    ifstream in(path);
+    if (!in)
+        throw runtime_error("Cannot open baseline "s + path);
+
+    map<pair<string, size_t>, double> ops_per_second;
+    string line;
+    getline(in, line);
+    while (getline(in, line)) {
+        istringstream fields(line);
+        string benchmark, corpus_size, operations, ops;
+        if (getline(fields, benchmark, ',') && getline(fields, corpus_size, ',')
+            && getline(fields, operations, ',') && getline(fields, ops, ',')) {
+            ops_per_second[{benchmark, stoul(corpus_size)}] = stod(ops);
+        }
+    }
+
+    return ops_per_second;
+}
+
+// Возвращает число замеров, которые медленнее baseline больше, чем на max_regression
+int CheckRegressions(const vector<Measurement>& measurements, const Options& options) {
+    const auto baseline = ReadBaseline(options.baseline_path);
+    int regression_count = 0;
+
+    for (const auto& measurement : measurements) {
+        const auto it = baseline.find({measurement.benchmark, measurement.corpus_size});
+        if (it == baseline.end() || it->second <= 0)
+            continue;
+
+        const double ratio = measurement.GetOpsPerSecond() / it->second;
+        if (ratio < 1 - options.max_regression) {
+            cerr << "REGRESSION "s << measurement.benchmark << " corpus_size="s << measurement.corpus_size
+                 << ": "s << measurement.GetOpsPerSecond() << " ops/s vs baseline "s << it->second
+                 << " ops/s"s << endl;
+            ++regression_count;
+        }
+    }
+
+    return regression_count;
+}
+
+Options ParseOptions(int argc, char* argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        const string_view name = argv[i];
+        if (i + 1 == argc)
+            throw invalid_argument("Missing value for "s + string(name));
+
+        const string value = argv[++i];
+        if (name == "--sizes"sv) {
+            options.corpus_sizes.clear();
+            istringstream sizes(value);
+            for (string size; getline(sizes, size, ',');) {
+                options.corpus_sizes.push_back(stoul(size));
+            }
+        } else if (name == "--queries"sv) {
+            options.query_count = stoi(value);
+        } else if (name == "--threads"sv) {
+            options.concurrency = stoul(value);
+        } else if (name == "--baseline"sv) {
+            options.baseline_path = value;
+        } else if (name == "--max-regression"sv) {
+            options.max_regression = stod(value);
+        } else {
+            throw invalid_argument("Unknown option "s + string(name));
+        }
+    }
+
+    return options;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options options = ParseOptions(argc, argv);
+
+        vector<Measurement> measurements;
+        PrintHeader(cout);
+        for (const size_t corpus_size : options.corpus_sizes) {
+            for (auto& measurement : RunBenchmarks(corpus_size, options)) {
+                PrintMeasurement(cout, measurement);
+                measurements.push_back(move(measurement));
+            }
+        }
+
+        if (!options.baseline_path.empty() && CheckRegressions(measurements, options) > 0)
+            return EXIT_FAILURE;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
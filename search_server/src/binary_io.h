@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Запись и чтение двоичных данных индекса. Числа пишутся в порядке байт платформы,
+// массивы и строки — в виде длины (uint64_t) и следующих за ней элементов
+
+template<typename T>
+void WriteValue(std::ostream& out, const T& value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void WriteArray(std::ostream& out, const std::vector<T>& values) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  WriteValue<uint64_t>(out, values.size());
+  out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+inline void WriteString(std::ostream& out, std::string_view str) {
+  WriteValue<uint64_t>(out, str.size());
+  out.write(str.data(), str.size());
+}
+
+inline void CheckStream(const std::istream& in) {
+  if (!in)
+    throw std::invalid_argument("Unexpected end of index data");
+}
+
+template<typename T>
+T ReadValue(std::istream& in) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  T value;
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  CheckStream(in);
+  return value;
+}
+
+// Память выделяется по мере чтения, поэтому повреждённая длина не приводит к огромному выделению
+template<typename T>
+void ReadArray(std::istream& in, std::vector<T>& values) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static constexpr uint64_t MAX_BLOCK_SIZE = (1 << 20) / sizeof(T) + 1;
+
+  const auto size = ReadValue<uint64_t>(in);
+  values.clear();
+  while (values.size() < size) {
+    const size_t read_count = std::min(size - values.size(), MAX_BLOCK_SIZE);
+    const size_t offset = values.size();
+    values.resize(offset + read_count);
+    in.read(reinterpret_cast<char*>(values.data() + offset), read_count * sizeof(T));
+    CheckStream(in);
+  }
+}
+
+inline std::string ReadString(std::istream& in) {
+  std::vector<char> chars;
+  ReadArray(in, chars);
+  return std::string(chars.begin(), chars.end());
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string_view>
+#include <vector>
+
 struct Document {
   Document() = default;
 
@@ -20,3 +23,11 @@ enum class DocumentStatus {
   BANNED,
   REMOVED,
 };
+
+// Документ для пакетного добавления; текст должен жить до конца вызова AddDocuments
+struct NewDocument {
+  int id = 0;
+  std::string_view text;
+  DocumentStatus status = DocumentStatus::ACTUAL;
+  std::vector<int> ratings;
+};
@@ -0,0 +1,98 @@
+#include "inverted_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+InvertedIndex::TermId InvertedIndex::AddTerm(string_view word) {
+  const TermId term = dictionary_.Add(word);
+  if (term == postings_.size()) {
+    postings_.emplace_back();
+    document_freqs_.push_back(0);
+    max_term_freqs_.push_back(0.0);
+    log_document_freqs_.push_back(-numeric_limits<double>::infinity());
+  }
+
+  return term;
+}
+
+const PostingList& InvertedIndex::GetPostings(TermId term) const {
+  return postings_.at(term);
+}
+
+void InvertedIndex::AddPosting(TermId term, size_t document_ordinal, double term_freq) {
+  auto& postings = postings_.at(term);
+
+  // порядковые номера документов растут, поэтому вхождение почти всегда дописывается в конец
+  if (postings.empty() || postings.back().document_ordinal < document_ordinal) {
+    postings.push_back({document_ordinal, term_freq});
+    ++document_freqs_[term];
+    UpdateDocumentFreq(term);
+    max_term_freqs_[term] = max(max_term_freqs_[term], term_freq);
+    return;
+  }
+
+  if (postings.back().document_ordinal == document_ordinal) {
+    postings.back().term_freq += term_freq;
+    max_term_freqs_[term] = max(max_term_freqs_[term], postings.back().term_freq);
+    return;
+  }
+
+  auto it = postings.begin() + (LowerBound(postings, document_ordinal) - postings.begin());
+  if (it != postings.end() && it->document_ordinal == document_ordinal) {
+    it->term_freq += term_freq;
+  } else {
+    it = postings.insert(it, {document_ordinal, term_freq});
+    ++document_freqs_[term];
+    UpdateDocumentFreq(term);
+  }
+  max_term_freqs_[term] = max(max_term_freqs_[term], it->term_freq);
+}
+
+void InvertedIndex::AppendPostings(TermId term, PostingList&& postings) {
+  auto& term_postings = postings_.at(term);
+  document_freqs_[term] += postings.size();
+  for (const auto& posting : postings) {
+    max_term_freqs_[term] = max(max_term_freqs_[term], posting.term_freq);
+  }
+
+  if (term_postings.empty()) {
+    term_postings = move(postings);
+  } else {
+    term_postings.insert(term_postings.end(), postings.begin(), postings.end());
+  }
+  UpdateDocumentFreq(term);
+}
+
+void InvertedIndex::RemoveDocumentFreq(TermId term, size_t removed_count) {
+  document_freqs_.at(term) -= removed_count;
+  UpdateDocumentFreq(term);
+}
+
+void InvertedIndex::CompactPostings(TermId term, const vector<size_t>& new_ordinals) {
+  auto& postings = postings_.at(term);
+  auto write = postings.begin();
+  max_term_freqs_[term] = 0.0;
+
+  for (const auto& posting : postings) {
+    const size_t new_ordinal = new_ordinals[posting.document_ordinal];
+    if (new_ordinal != NO_ORDINAL) {
+      *write++ = {new_ordinal, posting.term_freq};
+      max_term_freqs_[term] = max(max_term_freqs_[term], posting.term_freq);
+    }
+  }
+  postings.erase(write, postings.end());
+}
+
+void InvertedIndex::UpdateDocumentFreq(TermId term) {
+  log_document_freqs_[term] = log(static_cast<double>(document_freqs_[term]));
+}
+
+PostingList::const_iterator InvertedIndex::LowerBound(const PostingList& postings, size_t document_ordinal) {
+  return lower_bound(postings.begin(), postings.end(), document_ordinal,
+                     [](const Posting& posting, size_t ordinal) {
+                       return posting.document_ordinal < ordinal;
+                     });
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "term_dictionary.h"
+
+struct Posting {
+  size_t document_ordinal;
+  double term_freq;
+};
+
+// Список вхождений слова, упорядоченный по document_ordinal
+using PostingList = std::vector<Posting>;
+
+class InvertedIndex {
+ public:
+  using TermId = TermDictionary::TermId;
+
+  static constexpr TermId NO_TERM = TermDictionary::NO_TERM;
+
+  // Возвращает идентификатор слова или NO_TERM, если слово не встречалось
+  TermId FindTerm(std::string_view word) const {
+    return dictionary_.Find(word);
+  }
+
+  // Возвращает идентификатор слова, добавляя его в словарь при необходимости
+  TermId AddTerm(std::string_view word);
+
+  std::string_view GetWord(TermId term) const {
+    return dictionary_.GetWord(term);
+  }
+
+  size_t GetTermCount() const noexcept {
+    return postings_.size();
+  }
+
+  const PostingList& GetPostings(TermId term) const;
+
+  static constexpr size_t NO_ORDINAL = static_cast<size_t>(-1);
+
+  // Возвращает логарифм числа неудалённых документов со словом
+  double GetLogDocumentFreq(TermId term) const {
+    return log_document_freqs_[term];
+  }
+
+  // Возвращает оценку сверху частоты слова в документах; после удалений может быть завышена
+  double GetMaxTermFreq(TermId term) const {
+    return max_term_freqs_[term];
+  }
+
+  // Возвращает первое вхождение с порядковым номером не меньше document_ordinal
+  static PostingList::const_iterator LowerBound(const PostingList& postings, size_t document_ordinal);
+
+  // Прибавляет term_freq к частоте слова в документе
+  void AddPosting(TermId term, size_t document_ordinal, double term_freq);
+
+  // Дописывает вхождения документов, порядковые номера которых больше уже имеющихся
+  void AppendPostings(TermId term, PostingList&& postings);
+
+  // Учитывает удаление removed_count документов со словом. Их вхождения остаются в списке
+  // до сжатия, поэтому при поиске вхождения удалённых документов нужно пропускать
+  void RemoveDocumentFreq(TermId term, size_t removed_count = 1);
+
+  // Удаляет вхождения документов, которым в new_ordinals соответствует NO_ORDINAL,
+  // и перенумеровывает остальные. Новые номера должны сохранять порядок старых
+  void CompactPostings(TermId term, const std::vector<size_t>& new_ordinals);
+
+ private:
+  TermDictionary dictionary_;
+  std::vector<PostingList> postings_;
+  // число неудалённых документов со словом и его логарифм
+  std::vector<size_t> document_freqs_;
+  std::vector<double> log_document_freqs_;
+  std::vector<double> max_term_freqs_;
+
+  void UpdateDocumentFreq(TermId term);
+};
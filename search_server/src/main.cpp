@@ -1,7 +1,7 @@
+#include "generators.h"
 #include "search_server.h"
 #include "test_example_functions.h"
 #include "process_queries.h"
-#include "log_duration.h"
 
 #include <iostream>
 #include <string>
@@ -11,58 +11,19 @@
 
 using namespace std;
 
-string GenerateWord(mt19937& generator, int max_length) {
-    const int length = uniform_int_distribution(1, max_length)(generator);
-    string word;
-    word.reserve(length);
-    for (int i = 0; i < length; ++i) {
-        word.push_back(uniform_int_distribution('a', 'z')(generator));
-    }
-    return word;
-}
-
-vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
-    vector<string> words;
-    words.reserve(word_count);
-    for (int i = 0; i < word_count; ++i) {
-        words.push_back(GenerateWord(generator, max_length));
-    }
-    words.erase(unique(words.begin(), words.end()), words.end());
-    return words;
-}
-
-string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0) {
-    string query;
-    for (int i = 0; i < word_count; ++i) {
-        if (!query.empty()) {
-            query.push_back(' ');
-        }
-        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
-            query.push_back('-');
-        }
-        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
-    }
-    return query;
-}
-
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
-    vector<string> queries;
-    queries.reserve(query_count);
-    for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
-    }
-    return queries;
-}
-
 template <typename ExecutionPolicy>
 void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
-    LOG_DURATION(mark);
+    const auto& metrics = search_server.GetMetrics();
+    const uint64_t start_nanoseconds = metrics.GetSnapshot().GetLatency(Operation::FIND_TOP_DOCUMENTS).total_nanoseconds;
     double total_relevance = 0;
     for (const string_view query : queries) {
         for (const auto& document : search_server.FindTopDocuments(policy, query)) {
             total_relevance += document.relevance;
         }
     }
+    const uint64_t nanoseconds = metrics.GetSnapshot().GetLatency(Operation::FIND_TOP_DOCUMENTS).total_nanoseconds
+                                 - start_nanoseconds;
+    cout << mark << ": "sv << nanoseconds / 1'000'000 << " ms"sv << endl;
     cout << total_relevance << endl;
 }
 
@@ -77,6 +38,8 @@ int main() {
     const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
 
     SearchServer search_server(dictionary[0]);
+    // запросы повторяются в обоих замерах, без кеша сравниваются сами алгоритмы поиска
+    search_server.SetResultCacheCapacity(0);
     for (size_t i = 0; i < documents.size(); ++i) {
         search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
     }
@@ -85,4 +48,6 @@ int main() {
 
     TESTSEQ;
     TESTPAR;
+
+    search_server.GetMetrics().GetSnapshot().Export(cout);
 }
@@ -0,0 +1,150 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+string_view GetOperationName(Operation operation) {
+  switch (operation) {
+    case Operation::FIND_TOP_DOCUMENTS:
+      return "find_top_documents"sv;
+    case Operation::MATCH_DOCUMENT:
+      return "match_document"sv;
+    case Operation::ADD_DOCUMENT:
+      return "add_document"sv;
+    case Operation::ADD_DOCUMENTS:
+      return "add_documents"sv;
+    case Operation::REMOVE_DOCUMENT:
+      return "remove_document"sv;
+    case Operation::REMOVE_DOCUMENTS:
+      return "remove_documents"sv;
+    default:
+      return "unknown"sv;
+  }
+}
+
+string_view GetCounterName(Counter counter) {
+  switch (counter) {
+    case Counter::POSTINGS_SCANNED:
+      return "postings_scanned"sv;
+    case Counter::DOCUMENTS_SCORED:
+      return "documents_scored"sv;
+    case Counter::CACHE_HITS:
+      return "cache_hits"sv;
+    case Counter::CACHE_MISSES:
+      return "cache_misses"sv;
+    default:
+      return "unknown"sv;
+  }
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t nanoseconds) {
+  if (nanoseconds < SUB_BUCKET_COUNT)
+    return nanoseconds;
+
+  int exponent = 0;
+  for (uint64_t value = nanoseconds; value > 1; value >>= 1) {
+    ++exponent;
+  }
+  if (exponent > MAX_EXPONENT)
+    return BUCKET_COUNT - 1;
+
+  const size_t sub_bucket = (nanoseconds >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+  return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t bucket) {
+  if (bucket < SUB_BUCKET_COUNT)
+    return bucket;
+
+  const int exponent = static_cast<int>(bucket / SUB_BUCKET_COUNT) + SUB_BUCKET_BITS - 1;
+  const uint64_t sub_bucket = bucket % SUB_BUCKET_COUNT;
+  const int shift = exponent - SUB_BUCKET_BITS;
+  return ((SUB_BUCKET_COUNT + sub_bucket + 1) << shift) - 1;
+}
+
+uint64_t LatencySnapshot::GetQuantile(double quantile) const {
+  if (count == 0)
+    return 0;
+
+  const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(quantile * count)));
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+    seen += buckets[bucket];
+    if (seen >= rank)
+      return LatencyHistogram::GetBucketUpperBound(bucket);
+  }
+
+  return LatencyHistogram::GetBucketUpperBound(buckets.size() - 1);
+}
+
+void MetricsSnapshot::Export(ostream& out) const {
+  for (size_t i = 0; i < latencies_.size(); ++i) {
+    const auto& latency = latencies_[i];
+    const auto name = GetOperationName(static_cast<Operation>(i));
+    const double mean = latency.count ? latency.total_nanoseconds / 1000.0 / latency.count : 0;
+
+    out << name << "_count "sv << latency.count << '\n'
+        << name << "_mean_us "sv << mean << '\n'
+        << name << "_p50_us "sv << latency.GetQuantile(0.5) / 1000.0 << '\n'
+        << name << "_p99_us "sv << latency.GetQuantile(0.99) / 1000.0 << '\n'
+        << name << "_p999_us "sv << latency.GetQuantile(0.999) / 1000.0 << '\n'
+        << name << "_max_us "sv << latency.GetQuantile(1.0) / 1000.0 << '\n';
+  }
+
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    out << GetCounterName(static_cast<Counter>(i)) << ' ' << counters_[i] << '\n';
+  }
+}
+
+Metrics::Metrics() {
+  stripes_.reserve(STRIPE_COUNT);
+  for (size_t i = 0; i < STRIPE_COUNT; ++i) {
+    stripes_.push_back(make_unique<Stripe>());
+  }
+}
+
+void Metrics::RecordLatency(Operation operation, chrono::nanoseconds duration) {
+  const uint64_t nanoseconds = max<int64_t>(duration.count(), 0);
+  const size_t index = static_cast<size_t>(operation);
+
+  Stripe& stripe = GetThreadStripe();
+  stripe.buckets[index][LatencyHistogram::GetBucket(nanoseconds)].fetch_add(1, memory_order_relaxed);
+  stripe.total_nanoseconds[index].fetch_add(nanoseconds, memory_order_relaxed);
+}
+
+void Metrics::Increment(Counter counter, uint64_t value) {
+  GetThreadStripe().counters[static_cast<size_t>(counter)].fetch_add(value, memory_order_relaxed);
+}
+
+MetricsSnapshot Metrics::GetSnapshot() const {
+  MetricsSnapshot snapshot;
+
+  for (const auto& stripe : stripes_) {
+    for (size_t operation = 0; operation < snapshot.latencies_.size(); ++operation) {
+      auto& latency = snapshot.latencies_[operation];
+      for (size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+        const uint64_t count = stripe->buckets[operation][bucket].load(memory_order_relaxed);
+        latency.buckets[bucket] += count;
+        latency.count += count;
+      }
+      latency.total_nanoseconds += stripe->total_nanoseconds[operation].load(memory_order_relaxed);
+    }
+
+    for (size_t counter = 0; counter < snapshot.counters_.size(); ++counter) {
+      snapshot.counters_[counter] += stripe->counters[counter].load(memory_order_relaxed);
+    }
+  }
+
+  return snapshot;
+}
+
+Metrics::Stripe& Metrics::GetThreadStripe() {
+  static atomic<size_t> next_thread_index = 0;
+  // потоки распределяются по полосам по кругу, так что при числе потоков не больше STRIPE_COUNT
+  // каждый пишет в свою полосу и не делит с другими строки кеша
+  static thread_local const size_t thread_index = next_thread_index++;
+
+  return *stripes_[thread_index % STRIPE_COUNT];
+}
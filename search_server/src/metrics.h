@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+enum class Operation {
+  FIND_TOP_DOCUMENTS,
+  MATCH_DOCUMENT,
+  ADD_DOCUMENT,
+  ADD_DOCUMENTS,
+  REMOVE_DOCUMENT,
+  REMOVE_DOCUMENTS,
+  COUNT,
+};
+
+enum class Counter {
+  POSTINGS_SCANNED,
+  DOCUMENTS_SCORED,
+  CACHE_HITS,
+  CACHE_MISSES,
+  COUNT,
+};
+
+std::string_view GetOperationName(Operation operation);
+
+std::string_view GetCounterName(Counter counter);
+
+// Гистограмма длительностей с логарифмическими корзинами: каждая степень двойки делится на
+// 2^SUB_BUCKET_BITS равных частей, поэтому относительная погрешность квантилей не больше 1/16
+struct LatencyHistogram {
+  static constexpr int SUB_BUCKET_BITS = 4;
+  static constexpr int MAX_EXPONENT = 40;
+  static constexpr size_t SUB_BUCKET_COUNT = size_t{1} << SUB_BUCKET_BITS;
+  static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+  static size_t GetBucket(uint64_t nanoseconds);
+
+  // Наибольшее значение, попадающее в корзину
+  static uint64_t GetBucketUpperBound(size_t bucket);
+};
+
+struct LatencySnapshot {
+  uint64_t count = 0;
+  uint64_t total_nanoseconds = 0;
+  std::vector<uint64_t> buckets = std::vector<uint64_t>(LatencyHistogram::BUCKET_COUNT);
+
+  // Возвращает оценку сверху квантиля quantile из [0, 1] в наносекундах; 0 для пустой гистограммы
+  uint64_t GetQuantile(double quantile) const;
+};
+
+class MetricsSnapshot {
+ public:
+  const LatencySnapshot& GetLatency(Operation operation) const {
+    return latencies_[static_cast<size_t>(operation)];
+  }
+
+  uint64_t GetCounter(Counter counter) const {
+    return counters_[static_cast<size_t>(counter)];
+  }
+
+  // Печатает строки вида "имя значение": для каждой операции число вызовов, среднее,
+  // p50, p99, p999 и максимум в микросекундах, затем счётчики
+  void Export(std::ostream& out) const;
+
+ private:
+  friend class Metrics;
+
+  std::array<LatencySnapshot, static_cast<size_t>(Operation::COUNT)> latencies_;
+  std::array<uint64_t, static_cast<size_t>(Counter::COUNT)> counters_{};
+};
+
+// Метрики поискового сервера. Запись не блокирует: каждый поток пишет в свою полосу
+// атомарных счётчиков, а снимок суммирует полосы. Печати на горячем пути нет
+class Metrics {
+ public:
+  Metrics();
+
+  void RecordLatency(Operation operation, std::chrono::nanoseconds duration);
+
+  void Increment(Counter counter, uint64_t value = 1);
+
+  MetricsSnapshot GetSnapshot() const;
+
+ private:
+  static constexpr size_t STRIPE_COUNT = 16;
+
+  struct alignas(64) Stripe {
+    std::array<std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKET_COUNT>,
+               static_cast<size_t>(Operation::COUNT)> buckets{};
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(Operation::COUNT)> total_nanoseconds{};
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::COUNT)> counters{};
+  };
+
+  std::vector<std::unique_ptr<Stripe>> stripes_;
+
+  Stripe& GetThreadStripe();
+};
+
+// Записывает длительность своего времени жизни в метрики, как LogDuration, но без печати
+class LatencyTimer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  LatencyTimer(Metrics& metrics, Operation operation)
+      : metrics_(metrics),
+        operation_(operation) {
+  }
+
+  LatencyTimer(const LatencyTimer&) = delete;
+  LatencyTimer& operator=(const LatencyTimer&) = delete;
+
+  ~LatencyTimer() {
+    metrics_.RecordLatency(operation_, Clock::now() - start_time_);
+  }
+
+ private:
+  Metrics& metrics_;
+  Operation operation_;
+  const Clock::time_point start_time_ = Clock::now();
+};
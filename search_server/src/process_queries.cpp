@@ -2,33 +2,72 @@
 
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
                                                   const std::vector<std::string>& queries) {
-    std::vector<std::vector<Document>> result(queries.size());
-    
-    std::transform(std::execution::par,
-                   queries.begin(), queries.end(),
-                   result.begin(),
-                   [&search_server](const std::string& querie){return search_server.FindTopDocuments(querie);}
-                   
-    );
-        
+    const QueryBatchResult batch = search_server.FindTopDocumentsBatch(queries);
+
+    std::vector<std::vector<Document>> result;
+    result.reserve(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        result.emplace_back(batch[i].begin(), batch[i].end());
+    }
+
     return result;
 }
 
 std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
-    
-    auto queries_result = ProcessQueries(search_server, queries);
-    size_t size = 0;
-    for (auto documents : queries_result) {
-        size += documents.size();
-    }
-    
-    std::vector<Document> flat_result(size);
-    auto it = flat_result.begin();
-    for (auto documents : queries_result) {
-        it = std::move(documents.begin(), documents.end(), it);
+
+    return search_server.FindTopDocumentsBatch(queries).ExtractDocuments();
+}
+
+LazyJoinedDocuments::LazyJoinedDocuments(const SearchServer& search_server,
+                                         const std::vector<std::string>& queries,
+                                         size_t window_size)
+    : search_server_(search_server),
+      queries_(queries),
+      window_size_(std::max<size_t>(window_size, 1)) {
+    StartNextWindow();
+    LoadWindow();
+}
+
+LazyJoinedDocuments::~LazyJoinedDocuments() {
+    if (pending_.valid())
+        pending_.wait();
+}
+
+void LazyJoinedDocuments::Advance() {
+    ++position_;
+    LoadWindow();
+}
+
+void LazyJoinedDocuments::StartNextWindow() {
+    if (next_query_ == queries_.size())
+        return;
+
+    const auto first = queries_.begin() + next_query_;
+    next_query_ = std::min(next_query_ + window_size_, queries_.size());
+    const IteratorRange window_queries(first, queries_.begin() + next_query_);
+
+    auto task = std::make_shared<std::packaged_task<std::vector<Document>()>>(
+        [&search_server = search_server_, window_queries] {
+            return search_server.FindTopDocumentsBatch(window_queries).ExtractDocuments();
+        });
+    pending_ = task->get_future();
+    search_server_.GetThreadPool().Submit([task] {
+        (*task)();
+    });
+}
+
+void LazyJoinedDocuments::LoadWindow() {
+    while (position_ == window_.size() && pending_.valid()) {
+        window_ = pending_.get();
+        position_ = 0;
+        StartNextWindow();
     }
-    
-    return flat_result;
+}
+
+LazyJoinedDocuments ProcessQueriesJoinedLazy(const SearchServer& search_server,
+                                             const std::vector<std::string>& queries,
+                                             size_t window_size) {
+    return LazyJoinedDocuments(search_server, queries, window_size);
 }
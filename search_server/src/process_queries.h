@@ -1,6 +1,8 @@
 #pragma once
 #include <execution>
+#include <future>
 #include <iostream>
+#include <iterator>
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -14,3 +16,94 @@ std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_ser
 std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
+
+// Ленивая последовательность документов по всем запросам в порядке запросов.
+// Запросы обрабатываются окнами: пока читается одно окно, следующее считается в пуле сервера,
+// поэтому в памяти не больше двух окон результатов. Сервер и запросы должны жить дольше объекта
+class LazyJoinedDocuments {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator() = default;
+
+        explicit Iterator(LazyJoinedDocuments* owner)
+            : owner_(owner) {
+        }
+
+        reference operator*() const {
+            return owner_->window_[owner_->position_];
+        }
+
+        pointer operator->() const {
+            return &**this;
+        }
+
+        Iterator& operator++() {
+            owner_->Advance();
+            if (owner_->IsFinished())
+                owner_ = nullptr;
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const noexcept {
+            return owner_ == other.owner_;
+        }
+
+        bool operator!=(const Iterator& other) const noexcept {
+            return owner_ != other.owner_;
+        }
+
+    private:
+        LazyJoinedDocuments* owner_ = nullptr;
+    };
+
+    LazyJoinedDocuments(const SearchServer& search_server,
+                        const std::vector<std::string>& queries,
+                        size_t window_size);
+
+    LazyJoinedDocuments(const LazyJoinedDocuments&) = delete;
+    LazyJoinedDocuments& operator=(const LazyJoinedDocuments&) = delete;
+
+    ~LazyJoinedDocuments();
+
+    // Обход однократный: begin() продолжает с текущего документа
+    Iterator begin() {
+        return IsFinished() ? Iterator() : Iterator(this);
+    }
+
+    Iterator end() {
+        return {};
+    }
+
+private:
+    const SearchServer& search_server_;
+    const std::vector<std::string>& queries_;
+    size_t window_size_;
+    // первый запрос, ещё не отправленный на обработку
+    size_t next_query_ = 0;
+    std::vector<Document> window_;
+    size_t position_ = 0;
+    std::future<std::vector<Document>> pending_;
+
+    bool IsFinished() const noexcept {
+        return position_ == window_.size() && !pending_.valid();
+    }
+
+    void Advance();
+
+    void StartNextWindow();
+
+    // Переходит к следующему непустому окну, если текущее прочитано
+    void LoadWindow();
+};
+
+// Документы по запросам выдаются по мере обработки окон из window_size запросов
+LazyJoinedDocuments ProcessQueriesJoinedLazy(const SearchServer& search_server,
+                                             const std::vector<std::string>& queries,
+                                             size_t window_size = 1024);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "paginator.h"
+
+// Результаты пачки запросов в одном плоском буфере:
+// документы запроса i лежат в [offsets[i], offsets[i + 1])
+class QueryBatchResult {
+ public:
+  using Range = IteratorRange<std::vector<Document>::const_iterator>;
+
+  QueryBatchResult(std::vector<Document> documents, std::vector<size_t> offsets)
+      : documents_(std::move(documents)),
+        offsets_(std::move(offsets)) {
+  }
+
+  size_t size() const noexcept {
+    return offsets_.size() - 1;
+  }
+
+  Range operator[](size_t query_index) const {
+    return {documents_.begin() + offsets_[query_index], documents_.begin() + offsets_[query_index + 1]};
+  }
+
+  // Документы всех запросов подряд, в порядке запросов
+  const std::vector<Document>& GetDocuments() const noexcept {
+    return documents_;
+  }
+
+  std::vector<Document> ExtractDocuments() && {
+    return std::move(documents_);
+  }
+
+ private:
+  std::vector<Document> documents_;
+  std::vector<size_t> offsets_;
+};
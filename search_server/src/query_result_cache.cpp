@@ -0,0 +1,91 @@
+#include "query_result_cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+using namespace std;
+
+QueryResultCache::QueryResultCache(size_t capacity)
+    : capacity_(capacity),
+      shard_count_(clamp<size_t>(capacity, 1, MAX_SHARD_COUNT)) {
+  for (size_t i = 0; i < shard_count_; ++i) {
+    shards_[i].capacity = capacity / shard_count_ + (i < capacity % shard_count_ ? 1 : 0);
+  }
+}
+
+optional<vector<Document>> QueryResultCache::Find(string_view key, uint64_t generation) {
+  if (capacity_ > 0) {
+    Shard& shard = GetShard(key);
+    lock_guard lock(shard.mutex);
+
+    const auto position = shard.positions.find(key);
+    if (position != shard.positions.end()) {
+      const auto entry = position->second;
+      if (entry->generation == generation) {
+        shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+        hits_.fetch_add(1, memory_order_relaxed);
+        return entry->documents;
+      }
+
+      // результат посчитан для более старой версии индекса и больше не пригодится
+      if (entry->generation < generation) {
+        shard.positions.erase(position);
+        shard.entries.erase(entry);
+      }
+    }
+  }
+
+  misses_.fetch_add(1, memory_order_relaxed);
+  return nullopt;
+}
+
+void QueryResultCache::Insert(string key, uint64_t generation, vector<Document> documents) {
+  if (capacity_ == 0)
+    return;
+
+  Shard& shard = GetShard(key);
+  lock_guard lock(shard.mutex);
+
+  const auto position = shard.positions.find(key);
+  if (position != shard.positions.end()) {
+    if (position->second->generation > generation)
+      return;
+
+    position->second->generation = generation;
+    position->second->documents = move(documents);
+    shard.entries.splice(shard.entries.begin(), shard.entries, position->second);
+    return;
+  }
+
+  if (shard.entries.size() == shard.capacity) {
+    shard.positions.erase(shard.entries.back().key);
+    shard.entries.pop_back();
+  }
+
+  shard.entries.push_front({move(key), generation, move(documents)});
+  shard.positions.emplace(shard.entries.front().key, shard.entries.begin());
+}
+
+void QueryResultCache::Clear() {
+  for (auto& shard : shards_) {
+    lock_guard lock(shard.mutex);
+    shard.positions.clear();
+    shard.entries.clear();
+  }
+}
+
+QueryResultCache::Stats QueryResultCache::GetStats() const {
+  Stats stats{hits_.load(memory_order_relaxed), misses_.load(memory_order_relaxed), 0};
+
+  for (const auto& shard : shards_) {
+    lock_guard lock(shard.mutex);
+    stats.size += shard.entries.size();
+  }
+
+  return stats;
+}
+
+QueryResultCache::Shard& QueryResultCache::GetShard(string_view key) {
+  return shards_[hash<string_view>{}(key) % shard_count_];
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+
+// Ограниченный кеш результатов поиска, безопасный для одновременного использования.
+// Ключи разбиты на сегменты со своими блокировками и списками LRU; вместимости сегментов
+// в сумме равны вместимости кеша. Каждый результат помечен поколением индекса, для которого
+// он посчитан, и для другого поколения не возвращается. Поколения растут, поэтому из двух
+// результатов для одного ключа хранится более новый: копия сервера со старым индексом,
+// делящая с ним кеш, не вытесняет результаты текущей версии
+class QueryResultCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t size = 0;
+
+    double GetHitRate() const noexcept {
+      return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0;
+    }
+  };
+
+  // capacity — наибольшее число результатов; 0 отключает кеш
+  explicit QueryResultCache(size_t capacity);
+
+  QueryResultCache(const QueryResultCache&) = delete;
+  QueryResultCache& operator=(const QueryResultCache&) = delete;
+
+  size_t GetCapacity() const noexcept {
+    return capacity_;
+  }
+
+  std::optional<std::vector<Document>> Find(std::string_view key, uint64_t generation);
+
+  void Insert(std::string key, uint64_t generation, std::vector<Document> documents);
+
+  void Clear();
+
+  Stats GetStats() const;
+
+ private:
+  static constexpr size_t MAX_SHARD_COUNT = 16;
+
+  struct Entry {
+    std::string key;
+    uint64_t generation;
+    std::vector<Document> documents;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    size_t capacity = 0;
+    // недавно использованные в начале
+    std::list<Entry> entries;
+    // ключи указывают в строки entries
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> positions;
+  };
+
+  size_t capacity_;
+  // маленькому кешу достаются не все сегменты, чтобы в каждом было место хотя бы для одного результата
+  size_t shard_count_;
+  std::array<Shard, MAX_SHARD_COUNT> shards_;
+  std::atomic<uint64_t> hits_ = 0;
+  std::atomic<uint64_t> misses_ = 0;
+
+  Shard& GetShard(std::string_view key);
+};
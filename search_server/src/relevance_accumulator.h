@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Плотный накопитель релевантности, индексируемый порядковым номером документа.
+// Reset очищает только затронутые ячейки, поэтому объект выгодно переиспользовать между запросами
+class RelevanceAccumulator {
+ public:
+  void Reset(size_t ordinal_count) {
+    for (const size_t ordinal : touched_) {
+      relevance_[ordinal] = 0.0;
+      scored_[ordinal] = false;
+    }
+    for (const size_t ordinal : excluded_list_) {
+      excluded_[ordinal] = false;
+    }
+    touched_.clear();
+    excluded_list_.clear();
+
+    if (relevance_.size() < ordinal_count) {
+      relevance_.resize(ordinal_count, 0.0);
+      scored_.resize(ordinal_count, false);
+      excluded_.resize(ordinal_count, false);
+    }
+  }
+
+  void Add(size_t ordinal, double value) {
+    if (!scored_[ordinal]) {
+      scored_[ordinal] = true;
+      touched_.push_back(ordinal);
+    }
+    relevance_[ordinal] += value;
+  }
+
+  void Exclude(size_t ordinal) {
+    if (!excluded_[ordinal]) {
+      excluded_[ordinal] = true;
+      excluded_list_.push_back(ordinal);
+    }
+  }
+
+  bool IsExcluded(size_t ordinal) const {
+    return excluded_[ordinal];
+  }
+
+  // Вызывает function(ordinal, relevance) для каждого набравшего релевантность и не исключённого документа
+  template<typename Function>
+  void ForEachScored(Function function) const {
+    for (const size_t ordinal : touched_) {
+      if (!excluded_[ordinal]) {
+        function(ordinal, relevance_[ordinal]);
+      }
+    }
+  }
+
+ private:
+  std::vector<double> relevance_;
+  std::vector<bool> scored_;
+  std::vector<bool> excluded_;
+  std::vector<size_t> touched_;
+  std::vector<size_t> excluded_list_;
+};
@@ -2,39 +2,28 @@
 #include "search_server.h"
 #include "document.h"
 
-RequestQueue::RequestQueue(const SearchServer& search_server) noexcept
-    : search_server_(search_server) {
+RequestQueue::RequestQueue(const SearchServer& search_server, RequestStatistics::Clock::duration window)
+    : search_server_(search_server),
+      statistics_(window) {
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query,
                                                    DocumentStatus status) {
-  const std::vector<Document> result = search_server_.FindTopDocuments(raw_query, status);
-  RefreshDeque(result);
-  return result;
+  return AddRequest([&] {
+    return search_server_.FindTopDocuments(raw_query, status);
+  });
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
-  const std::vector<Document> result = search_server_.FindTopDocuments(raw_query);
-  RefreshDeque(result);
-  return result;
+  return AddRequest([&] {
+    return search_server_.FindTopDocuments(raw_query);
+  });
 }
 
-int RequestQueue::GetNoResultRequests() const noexcept {
-  return empty_resul_cnt_;
+int RequestQueue::GetNoResultRequests() const {
+  return static_cast<int>(statistics_.GetStats().empty_result_count);
 }
 
-void RequestQueue::RefreshDeque(const std::vector<Document>& result) {
-  if (static_cast<int>(requests_.size()) >= sec_in_day_) {
-    if (requests_.front().empty_result == true)
-      --empty_resul_cnt_;
-
-    requests_.pop_front();
-  }
-
-  if (result.empty()) {
-    requests_.push_back( {true});
-    ++empty_resul_cnt_;
-  } else {
-    requests_.push_back( {false});
-  }
+RequestWindowStats RequestQueue::GetStatistics() const {
+  return statistics_.GetStats();
 }
@@ -1,15 +1,19 @@
 #pragma once
 
-#include <deque>
+#include <chrono>
 #include <string>
 #include <vector>
 
 #include "document.h"
+#include "request_statistics.h"
 #include "search_server.h"
 
+// Передаёт запросы серверу и ведёт статистику по ним за последние сутки.
+// Запросы можно добавлять из нескольких потоков одновременно
 class RequestQueue {
  public:
-  explicit RequestQueue(const SearchServer& search_server) noexcept;
+  explicit RequestQueue(const SearchServer& search_server,
+                        RequestStatistics::Clock::duration window = std::chrono::hours(24));
 
   template<typename DocumentPredicate>
   std::vector<Document> AddFindRequest(const std::string& raw_query,
@@ -19,26 +23,34 @@ class RequestQueue {
 
   std::vector<Document> AddFindRequest(const std::string& raw_query);
 
-  int GetNoResultRequests() const noexcept;
- private:
-  struct QueryResult {
-    bool empty_result;
-  };
+  // Число запросов без результатов за окно статистики
+  int GetNoResultRequests() const;
 
-  std::deque<QueryResult> requests_;
-  const static int sec_in_day_ = 1440;
-  const SearchServer& search_server_;
-  int empty_resul_cnt_ = 0;
+  // Доля пустых результатов, число запросов в секунду и квантили длительности за окно статистики
+  RequestWindowStats GetStatistics() const;
 
-  void RefreshDeque(const std::vector<Document>& result);
+ private:
+  const SearchServer& search_server_;
+  RequestStatistics statistics_;
 
+  template<typename Search>
+  std::vector<Document> AddRequest(Search search);
 };
 
 template<typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query,
                                                    DocumentPredicate document_predicate) {
-  const std::vector<Document> result = search_server_.FindTopDocuments(raw_query,
-                                                                       document_predicate);
-  RefreshDeque(result);
+  return AddRequest([&] {
+    return search_server_.FindTopDocuments(raw_query, document_predicate);
+  });
+}
+
+template<typename Search>
+std::vector<Document> RequestQueue::AddRequest(Search search) {
+  const auto start_time = RequestStatistics::Clock::now();
+  std::vector<Document> result = search();
+  const auto end_time = RequestStatistics::Clock::now();
+
+  statistics_.Record(end_time - start_time, result.empty(), end_time);
   return result;
 }
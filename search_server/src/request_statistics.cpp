@@ -0,0 +1,117 @@
+#include "request_statistics.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+RequestStatistics::RequestStatistics(Clock::duration window, Clock::time_point start_time)
+    : start_time_(start_time),
+      slot_duration_(window / SLOT_COUNT),
+      slots_(make_unique<Slot[]>(SLOT_COUNT)) {
+  if (slot_duration_ <= Clock::duration::zero())
+    throw invalid_argument("Statistics window is too short"s);
+}
+
+void RequestStatistics::Record(chrono::nanoseconds latency, bool is_empty_result, Clock::time_point now) {
+  Slot* slot = AcquireSlot(GetEpoch(now) & EPOCH_MASK);
+  if (!slot)
+    return;
+
+  const uint64_t nanoseconds = max<int64_t>(latency.count(), 0);
+  slot->request_count.fetch_add(1, memory_order_relaxed);
+  if (is_empty_result)
+    slot->empty_result_count.fetch_add(1, memory_order_relaxed);
+  slot->total_nanoseconds.fetch_add(nanoseconds, memory_order_relaxed);
+  slot->latency_buckets[LatencyHistogram::GetBucket(nanoseconds)].fetch_add(1, memory_order_relaxed);
+  ReleaseSlot(*slot);
+}
+
+RequestWindowStats RequestStatistics::GetStats(Clock::time_point now) const {
+  RequestWindowStats stats;
+  const uint64_t current_epoch = GetEpoch(now) & EPOCH_MASK;
+
+  for (size_t i = 0; i < SLOT_COUNT; ++i) {
+    const Slot& slot = slots_[i];
+    const uint64_t state = slot.state.load(memory_order_acquire);
+    const uint64_t epoch = GetStateEpoch(state);
+    if ((state & RESETTING) || epoch > current_epoch || current_epoch - epoch >= SLOT_COUNT)
+      continue;
+
+    const uint64_t request_count = slot.request_count.load(memory_order_relaxed);
+    const uint64_t empty_result_count = slot.empty_result_count.load(memory_order_relaxed);
+    const uint64_t total_nanoseconds = slot.total_nanoseconds.load(memory_order_relaxed);
+    array<uint64_t, LatencyHistogram::BUCKET_COUNT> buckets;
+    for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+      buckets[bucket] = slot.latency_buckets[bucket].load(memory_order_relaxed);
+    }
+
+    // пока слот читался, его могли отдать новому интервалу
+    atomic_thread_fence(memory_order_acquire);
+    const uint64_t last_state = slot.state.load(memory_order_relaxed);
+    if ((last_state & RESETTING) || GetStateEpoch(last_state) != epoch)
+      continue;
+
+    stats.request_count += request_count;
+    stats.empty_result_count += empty_result_count;
+    stats.latency.total_nanoseconds += total_nanoseconds;
+    for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+      stats.latency.buckets[bucket] += buckets[bucket];
+      stats.latency.count += buckets[bucket];
+    }
+  }
+
+  const auto covered = min(GetWindow(), max(now - start_time_, Clock::duration::zero()));
+  const double seconds = chrono::duration<double>(covered).count();
+  stats.requests_per_second = seconds > 0 ? stats.request_count / seconds : 0.0;
+
+  return stats;
+}
+
+uint64_t RequestStatistics::GetEpoch(Clock::time_point time) const {
+  return time > start_time_ ? static_cast<uint64_t>((time - start_time_) / slot_duration_) : 0;
+}
+
+RequestStatistics::Slot* RequestStatistics::AcquireSlot(uint64_t epoch) {
+  Slot& slot = slots_[epoch % SLOT_COUNT];
+  const uint64_t epoch_state = epoch << WRITER_BITS;
+
+  uint64_t state = slot.state.load(memory_order_acquire);
+  while (true) {
+    const uint64_t slot_epoch = GetStateEpoch(state);
+    if (slot_epoch > epoch)
+      return nullptr;
+
+    if (slot_epoch == epoch && !(state & RESETTING)) {
+      if ((state & WRITER_MASK) == WRITER_MASK)
+        throw overflow_error("Too many concurrent statistics writers"s);
+      if (slot.state.compare_exchange_weak(state, state + 1, memory_order_acquire))
+        return &slot;
+      continue;
+    }
+
+    if (slot_epoch < epoch && state == (slot_epoch << WRITER_BITS)) {
+      // старый интервал закрыт и писателей у него нет: слот обнуляет этот поток
+      if (!slot.state.compare_exchange_weak(state, epoch_state | RESETTING, memory_order_acquire))
+        continue;
+
+      slot.request_count.store(0, memory_order_relaxed);
+      slot.empty_result_count.store(0, memory_order_relaxed);
+      slot.total_nanoseconds.store(0, memory_order_relaxed);
+      for (auto& bucket : slot.latency_buckets) {
+        bucket.store(0, memory_order_relaxed);
+      }
+      slot.state.store(epoch_state + 1, memory_order_release);
+      return &slot;
+    }
+
+    // слот обнуляется или в него дописывают старый интервал; это единицы атомарных операций
+    this_thread::yield();
+    state = slot.state.load(memory_order_acquire);
+  }
+}
+
+void RequestStatistics::ReleaseSlot(Slot& slot) noexcept {
+  slot.state.fetch_sub(1, memory_order_release);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "metrics.h"
+
+struct RequestWindowStats {
+  uint64_t request_count = 0;
+  uint64_t empty_result_count = 0;
+  double requests_per_second = 0.0;
+  LatencySnapshot latency;
+
+  double GetEmptyResultRate() const noexcept {
+    return request_count ? static_cast<double>(empty_result_count) / request_count : 0.0;
+  }
+};
+
+// Статистика запросов за последний отрезок времени window. Окно разбито на SLOT_COUNT интервалов
+// в кольцевом буфере фиксированного размера; интервал, из которого ушло время, обнуляется первым
+// записавшим в него потоком. Запись и чтение безопасны из любого числа потоков и не берут мьютексов.
+// Внутри интервала запись — это одно сравнение с обменом и несколько атомарных сложений, но структура
+// не lock-free: на границе интервала писатели слота ждут, пока завершатся записи старого интервала
+// и слот обнулится
+class RequestStatistics {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t SLOT_COUNT = 64;
+
+  explicit RequestStatistics(Clock::duration window, Clock::time_point start_time = Clock::now());
+
+  RequestStatistics(const RequestStatistics&) = delete;
+  RequestStatistics& operator=(const RequestStatistics&) = delete;
+
+  Clock::duration GetWindow() const noexcept {
+    return slot_duration_ * SLOT_COUNT;
+  }
+
+  void Record(std::chrono::nanoseconds latency, bool is_empty_result, Clock::time_point now = Clock::now());
+
+  // Учитывает интервалы, целиком или частично попадающие в окно, которое заканчивается в now
+  RequestWindowStats GetStats(Clock::time_point now = Clock::now()) const;
+
+ private:
+  // Состояние слота в одном слове: признак обнуления, номер интервала от start_time_, данные которого
+  // лежат в слоте, и число потоков, которые сейчас в него пишут. Слот обнуляется, только когда
+  // писателей нет, поэтому опоздавший писатель не может добавить данные в чужой интервал
+  static constexpr uint64_t RESETTING = uint64_t{1} << 63;
+  static constexpr int WRITER_BITS = 16;
+  static constexpr uint64_t WRITER_MASK = (uint64_t{1} << WRITER_BITS) - 1;
+  static constexpr uint64_t EPOCH_MASK = ~RESETTING >> WRITER_BITS;
+
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> state = 0;
+    std::atomic<uint64_t> request_count = 0;
+    std::atomic<uint64_t> empty_result_count = 0;
+    std::atomic<uint64_t> total_nanoseconds = 0;
+    std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKET_COUNT> latency_buckets{};
+  };
+
+  Clock::time_point start_time_;
+  Clock::duration slot_duration_;
+  // слоты занимают сотни килобайт и не размещаются в объекте, чтобы его можно было держать на стеке
+  std::unique_ptr<Slot[]> slots_;
+
+  uint64_t GetEpoch(Clock::time_point time) const;
+
+  static uint64_t GetStateEpoch(uint64_t state) noexcept {
+    return (state >> WRITER_BITS) & EPOCH_MASK;
+  }
+
+  // Возвращает слот интервала epoch, при необходимости освободив его от старых данных, и
+  // регистрирует поток его писателем до вызова ReleaseSlot. Возвращает nullptr, если слот уже
+  // занят более новым интервалом
+  Slot* AcquireSlot(uint64_t epoch);
+
+  static void ReleaseSlot(Slot& slot) noexcept;
+};
@@ -3,22 +3,7 @@
 using namespace std;
 
 void RemoveDuplicates(SearchServer& search_server) {
-  std::set<int> remove_documents;
-
-  for (auto current_id = search_server.begin(); current_id != search_server.end(); ++current_id) {
-    auto current_doc_id_to_word_freq = search_server.GetWordFrequencies(*current_id);
-
-      for (auto next_id = current_id + 1; next_id != search_server.end(); ++next_id) {
-        auto next_doc_id_to_word_freq = search_server.GetWordFrequencies(*next_id);
-
-        if (key_compare(next_doc_id_to_word_freq, current_doc_id_to_word_freq))
-          remove_documents.emplace(*next_id);
-      }
-  }
-
-  for (auto document_id : remove_documents) {
-    search_server.RemoveDocument(document_id);
-  }
+  search_server.RemoveDocuments(search_server.FindDuplicates());
 }
 
 bool SearchServer::TryAddDocument(
@@ -56,9 +41,7 @@ bool SearchServer::TryMatchDocuments(string_view query) {
   try {
     cout << "Матчинг документов по запросу: "s << query << endl;
 
-    for (auto it = begin(); it != end(); ++it) {
-      const auto [words, status] = MatchDocument(query, *it);
-    }
+    MatchDocuments(query, document_ids_);
 
     return true;
   } catch (const invalid_argument& e) {
@@ -74,40 +57,370 @@ void SearchServer::AddDocument(
                                  const vector<int>& ratings
  )
 {
+  LatencyTimer timer(*metrics_, Operation::ADD_DOCUMENT);
   if ((document_id < 0) || documents_.count(document_id))
     throw invalid_argument("Invalid document_id"s);
 
   const auto words = SplitIntoWordsNoStop(document);
   const double inv_word_count = 1.0 / words.size();
+  const size_t document_ordinal = ordinal_to_document_id_.size();
+  vector<TermFrequency> term_freqs;
+  term_freqs.reserve(words.size());
 
   for (const auto& word : words) {
-    word_to_document_freqs_[sv_to_s(word)][document_id] += inv_word_count;
-    document_to_word_freqs_[document_id][sv_to_s(word)] += inv_word_count;
+    term_freqs.push_back({inverted_index_.AddTerm(word), inv_word_count});
   }
 
-  documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
+  sort(term_freqs.begin(), term_freqs.end(), [](const TermFrequency& lhs, const TermFrequency& rhs) {
+    return lhs.term < rhs.term;
+  });
+
+  // повторы слова складываются по одному, как и раньше, чтобы частота не зависела от способа подсчёта
+  vector<TermFrequency> unique_term_freqs;
+  for (const auto& term_freq : term_freqs) {
+    if (!unique_term_freqs.empty() && unique_term_freqs.back().term == term_freq.term) {
+      unique_term_freqs.back().term_freq += term_freq.term_freq;
+    } else {
+      unique_term_freqs.push_back(term_freq);
+    }
+  }
+
+  for (const auto& [term, term_freq] : unique_term_freqs) {
+    inverted_index_.AddPosting(term, document_ordinal, term_freq);
+  }
+
+  const uint64_t fingerprint = ComputeWordSetFingerprint(unique_term_freqs);
+  fingerprint_to_document_ids_[fingerprint].push_back(document_id);
+
+  sort(unique_term_freqs.begin(), unique_term_freqs.end(), [this](const TermFrequency& lhs, const TermFrequency& rhs) {
+    return inverted_index_.GetWord(lhs.term) < inverted_index_.GetWord(rhs.term);
+  });
+  ordinal_to_term_freqs_.push_back(move(unique_term_freqs));
+
+  documents_.emplace(document_id, DocumentData{document_ordinal, document_ids_.size(), fingerprint});
+  ordinal_to_metadata_.push_back({ComputeAverageRating(ratings), status});
   document_ids_.push_back(document_id);
+  ordinal_to_document_id_.push_back(document_id);
+  UpdateDocumentCount();
 }
 
-void SearchServer::RemoveDocument(int document_id) {
-  auto it = find(document_ids_.begin(), document_ids_.end(), document_id);
-
-  if (it == document_ids_.end())
+template<typename ExecutionPolicy>
+void SearchServer::AddDocumentsImpl(const ExecutionPolicy& policy, const vector<NewDocument>& documents) {
+  if (documents.empty())
     return;
 
-  document_ids_.erase(it);
-  documents_.erase(document_id);
-  document_to_word_freqs_.erase(document_id);
+  LatencyTimer timer(*metrics_, Operation::ADD_DOCUMENTS);
+
+  unordered_set<int> batch_ids;
+  for (const auto& document : documents) {
+    if (document.id < 0 || documents_.count(document.id) || !batch_ids.insert(document.id).second)
+      throw invalid_argument("Invalid document_id"s);
+  }
+
+  const size_t first_ordinal = ordinal_to_document_id_.size();
+  const size_t part_count = is_same_v<ExecutionPolicy, std::execution::sequenced_policy>
+                            ? 1 : min(thread_pool_->GetConcurrency(), documents.size());
+
+  vector<size_t> parts(part_count);
+  iota(parts.begin(), parts.end(), 0);
+  const auto part_begin = [&documents, part_count](size_t part) {
+    return documents.size() * part / part_count;
+  };
+
+  // частоты слов каждого документа по алфавиту; сначала в нумерации своей части, после слияния — в общей
+  vector<vector<TermFrequency>> term_freqs(documents.size());
+  vector<PartialIndex> partial_indexes(part_count);
+
+  ForEach(policy, parts, [&](size_t part) {
+    auto& partial_index = partial_indexes[part];
+    unordered_map<string_view, InvertedIndex::TermId> local_terms;
+
+    for (size_t i = part_begin(part); i < part_begin(part + 1); ++i) {
+      auto words = SplitIntoWordsNoStop(documents[i].text);
+      const double inv_word_count = 1.0 / words.size();
+      sort(words.begin(), words.end());
+
+      for (size_t j = 0; j < words.size(); ++j) {
+        if (j > 0 && words[j] == words[j - 1]) {
+          term_freqs[i].back().term_freq += inv_word_count;
+          continue;
+        }
+
+        const auto [it, inserted] = local_terms.emplace(words[j], partial_index.words.size());
+        if (inserted) {
+          partial_index.words.push_back(words[j]);
+          partial_index.postings.emplace_back();
+        }
+        term_freqs[i].push_back({it->second, inv_word_count});
+      }
+
+      for (const auto& [term, term_freq] : term_freqs[i]) {
+        partial_index.postings[term].push_back({first_ordinal + i, term_freq});
+      }
+    }
+  });
 
-  std::vector<const std::string*> words;
+  // части сливаются по порядку, поэтому вхождения каждого слова остаются упорядоченными
+  vector<vector<InvertedIndex::TermId>> local_to_global(part_count);
+  for (size_t part = 0; part < part_count; ++part) {
+    auto& partial_index = partial_indexes[part];
+    local_to_global[part].reserve(partial_index.words.size());
 
-  for (const auto& [word, _] : word_to_document_freqs_) {
-    words.push_back(&word);
+    for (size_t term = 0; term < partial_index.words.size(); ++term) {
+      const auto global_term = inverted_index_.AddTerm(partial_index.words[term]);
+      inverted_index_.AppendPostings(global_term, move(partial_index.postings[term]));
+      local_to_global[part].push_back(global_term);
+    }
   }
 
-  for_each(words.begin(), words.end(),
-           [&](const std::string* word){word_to_document_freqs_.at(*word).erase(document_id);}
-   );
+  vector<uint64_t> fingerprints(documents.size());
+  ForEach(policy, parts, [&](size_t part) {
+    vector<TermFrequency> sorted_by_term;
+
+    for (size_t i = part_begin(part); i < part_begin(part + 1); ++i) {
+      for (auto& term_freq : term_freqs[i]) {
+        term_freq.term = local_to_global[part][term_freq.term];
+      }
+
+      sorted_by_term = term_freqs[i];
+      sort(sorted_by_term.begin(), sorted_by_term.end(), [](const TermFrequency& lhs, const TermFrequency& rhs) {
+        return lhs.term < rhs.term;
+      });
+      fingerprints[i] = ComputeWordSetFingerprint(sorted_by_term);
+    }
+  });
+
+  ordinal_to_term_freqs_.reserve(first_ordinal + documents.size());
+  ordinal_to_document_id_.reserve(first_ordinal + documents.size());
+  ordinal_to_metadata_.reserve(first_ordinal + documents.size());
+  document_ids_.reserve(document_ids_.size() + documents.size());
+  documents_.reserve(documents_.size() + documents.size());
+
+  for (size_t i = 0; i < documents.size(); ++i) {
+    const auto& document = documents[i];
+
+    fingerprint_to_document_ids_[fingerprints[i]].push_back(document.id);
+    ordinal_to_term_freqs_.push_back(move(term_freqs[i]));
+    documents_.emplace(document.id, DocumentData{first_ordinal + i, document_ids_.size(), fingerprints[i]});
+    ordinal_to_metadata_.push_back({ComputeAverageRating(document.ratings), document.status});
+    document_ids_.push_back(document.id);
+    ordinal_to_document_id_.push_back(document.id);
+  }
+  UpdateDocumentCount();
+}
+
+void SearchServer::AddDocuments(const vector<NewDocument>& documents) {
+  AddDocumentsImpl(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::sequenced_policy&, const vector<NewDocument>& documents) {
+  AddDocumentsImpl(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::parallel_policy&, const vector<NewDocument>& documents) {
+  AddDocumentsImpl(std::execution::par, documents);
+}
+
+void SearchServer::SaveIndex(ostream& out) const {
+  out.write(INDEX_MAGIC.data(), INDEX_MAGIC.size());
+  WriteValue(out, INDEX_VERSION);
+
+  WriteValue<uint64_t>(out, stop_words_.size());
+  for (const auto& stop_word : stop_words_) {
+    WriteString(out, stop_word);
+  }
+
+  WriteArray(out, ordinal_to_document_id_);
+
+  WriteValue<uint64_t>(out, inverted_index_.GetTermCount());
+  for (InvertedIndex::TermId term = 0; term < inverted_index_.GetTermCount(); ++term) {
+    WriteString(out, inverted_index_.GetWord(term));
+    WriteArray(out, inverted_index_.GetPostings(term));
+  }
+
+  for (const auto& term_freqs : ordinal_to_term_freqs_) {
+    WriteArray(out, term_freqs);
+  }
+
+  // данные документов пишутся столбцами в порядке document_ids_, чтобы читать их целиком
+  vector<int> ratings;
+  vector<DocumentStatus> statuses;
+  vector<uint64_t> ordinals;
+  vector<uint64_t> fingerprints;
+  for (const int document_id : document_ids_) {
+    const auto& document = documents_.at(document_id);
+    ratings.push_back(ordinal_to_metadata_[document.ordinal].rating);
+    statuses.push_back(ordinal_to_metadata_[document.ordinal].status);
+    ordinals.push_back(document.ordinal);
+    fingerprints.push_back(document.fingerprint);
+  }
+
+  WriteArray(out, document_ids_);
+  WriteArray(out, ratings);
+  WriteArray(out, statuses);
+  WriteArray(out, ordinals);
+  WriteArray(out, fingerprints);
+
+  if (!out)
+    throw runtime_error("Failed to write index"s);
+}
+
+SearchServer SearchServer::OpenIndex(istream& in, size_t concurrency) {
+  string magic(INDEX_MAGIC.size(), '\0');
+  in.read(magic.data(), magic.size());
+  if (!in || magic != INDEX_MAGIC || ReadValue<uint32_t>(in) != INDEX_VERSION)
+    throw invalid_argument("Unsupported index format"s);
+
+  // слова читаются по одному: повреждённое число слов не должно приводить к огромному выделению
+  const auto stop_word_count = ReadValue<uint64_t>(in);
+  vector<string> stop_words;
+  for (uint64_t i = 0; i < stop_word_count; ++i) {
+    stop_words.push_back(ReadString(in));
+  }
+
+  SearchServer server(stop_words, concurrency);
+  const auto corrupted = [] {
+    return invalid_argument("Index data is corrupted"s);
+  };
+
+  ReadArray(in, server.ordinal_to_document_id_);
+  const size_t ordinal_count = server.ordinal_to_document_id_.size();
+  server.removed_ordinal_count_ = count(server.ordinal_to_document_id_.begin(),
+                                        server.ordinal_to_document_id_.end(), NO_DOCUMENT);
+
+  const auto term_count = ReadValue<uint64_t>(in);
+  PostingList postings;
+  for (InvertedIndex::TermId term = 0; term < term_count; ++term) {
+    if (server.inverted_index_.AddTerm(ReadString(in)) != term)
+      throw corrupted();
+
+    ReadArray(in, postings);
+    for (size_t i = 0; i < postings.size(); ++i) {
+      if (postings[i].document_ordinal >= ordinal_count
+          || (i > 0 && postings[i - 1].document_ordinal >= postings[i].document_ordinal))
+        throw corrupted();
+    }
+
+    // вхождения удалённых документов, ещё не убранные сжатием, не загружаются
+    postings.erase(remove_if(postings.begin(), postings.end(), [&server](const Posting& posting) {
+      return server.ordinal_to_document_id_[posting.document_ordinal] == NO_DOCUMENT;
+    }), postings.end());
+    server.inverted_index_.AppendPostings(term, move(postings));
+  }
+
+  // Прямой индекс должен описывать те же вхождения, что и списки: удаление документа уменьшает
+  // частоты слов из его прямого индекса, и расхождение испортило бы частоты
+  vector<size_t> forward_counts(term_count, 0);
+  server.ordinal_to_term_freqs_.resize(ordinal_count);
+  for (size_t ordinal = 0; ordinal < ordinal_count; ++ordinal) {
+    auto& term_freqs = server.ordinal_to_term_freqs_[ordinal];
+    ReadArray(in, term_freqs);
+    // у удалённых документов прямой индекс пуст, у живых слова идут строго по алфавиту
+    if (server.ordinal_to_document_id_[ordinal] == NO_DOCUMENT && !term_freqs.empty())
+      throw corrupted();
+    for (size_t i = 0; i < term_freqs.size(); ++i) {
+      const auto [term, term_freq] = term_freqs[i];
+      if (term >= term_count
+          || (i > 0 && server.inverted_index_.GetWord(term_freqs[i - 1].term) >= server.inverted_index_.GetWord(term)))
+        throw corrupted();
+
+      const auto& term_postings = server.inverted_index_.GetPostings(term);
+      const auto posting = InvertedIndex::LowerBound(term_postings, ordinal);
+      if (posting == term_postings.end() || posting->document_ordinal != ordinal || posting->term_freq != term_freq)
+        throw corrupted();
+      ++forward_counts[term];
+    }
+  }
+  // каждое вхождение найдено в прямом индексе, значит, лишних вхождений нет, если их число совпадает
+  for (InvertedIndex::TermId term = 0; term < term_count; ++term) {
+    if (server.inverted_index_.GetPostings(term).size() != forward_counts[term])
+      throw corrupted();
+  }
+
+  vector<int> ratings;
+  vector<DocumentStatus> statuses;
+  vector<uint64_t> ordinals;
+  vector<uint64_t> fingerprints;
+  ReadArray(in, server.document_ids_);
+  ReadArray(in, ratings);
+  ReadArray(in, statuses);
+  ReadArray(in, ordinals);
+  ReadArray(in, fingerprints);
+
+  const size_t document_count = server.document_ids_.size();
+  if (ratings.size() != document_count || statuses.size() != document_count
+      || ordinals.size() != document_count || fingerprints.size() != document_count)
+    throw corrupted();
+
+  // каждый живой номер должен принадлежать документу из списка, иначе поиск вернёт несуществующий id
+  if (ordinal_count - server.removed_ordinal_count_ != document_count)
+    throw corrupted();
+
+  server.documents_.reserve(document_count);
+  server.ordinal_to_metadata_.resize(ordinal_count, {0, DocumentStatus::REMOVED});
+  for (size_t position = 0; position < document_count; ++position) {
+    const int document_id = server.document_ids_[position];
+    if (document_id < 0 || ordinals[position] >= ordinal_count
+        || server.ordinal_to_document_id_[ordinals[position]] != document_id)
+      throw corrupted();
+
+    const auto status = static_cast<int>(statuses[position]);
+    if (status < static_cast<int>(DocumentStatus::ACTUAL) || status > static_cast<int>(DocumentStatus::REMOVED))
+      throw corrupted();
+
+    if (!server.documents_.emplace(document_id, DocumentData{ordinals[position], position,
+                                                             fingerprints[position]}).second)
+      throw corrupted();
+    server.ordinal_to_metadata_[ordinals[position]] = {ratings[position], statuses[position]};
+    server.fingerprint_to_document_ids_[fingerprints[position]].push_back(document_id);
+  }
+  server.UpdateDocumentCount();
+
+  return server;
+}
+
+vector<int> SearchServer::FindDuplicates() const {
+  vector<int> duplicates;
+
+  for (const auto& [_, document_ids] : fingerprint_to_document_ids_) {
+    if (document_ids.size() < 2)
+      continue;
+
+    vector<int> candidates = document_ids;
+    sort(candidates.begin(), candidates.end());
+
+    // совпадение отпечатков проверяется сравнением наборов слов, чтобы коллизия хеша не удалила документ
+    vector<int> originals;
+    for (const int document_id : candidates) {
+      const auto words = GetWordFrequencies(document_id);
+      const bool is_duplicate = any_of(originals.begin(), originals.end(), [&](int original_id) {
+        return key_compare(words, GetWordFrequencies(original_id));
+      });
+
+      if (is_duplicate) {
+        duplicates.push_back(document_id);
+      } else {
+        originals.push_back(document_id);
+      }
+    }
+  }
+
+  sort(duplicates.begin(), duplicates.end());
+  return duplicates;
+}
+
+void SearchServer::RemoveDocument(int document_id) {
+  LatencyTimer timer(*metrics_, Operation::REMOVE_DOCUMENT);
+  const auto document = documents_.find(document_id);
+
+  if (document == documents_.end())
+    return;
+
+  for (const auto& [term, _] : ordinal_to_term_freqs_[document->second.ordinal]) {
+    inverted_index_.RemoveDocumentFreq(term);
+  }
+
+  EraseDocumentData(document_id);
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id) {
@@ -115,80 +428,357 @@ void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int d
 }
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id) {
-  auto it = find(std::execution::par, document_ids_.begin(), document_ids_.end(), document_id);
+  LatencyTimer timer(*metrics_, Operation::REMOVE_DOCUMENT);
+  const auto document = documents_.find(document_id);
 
-  if (it == document_ids_.end())
+  if (document == documents_.end())
     return;
 
-  document_ids_.erase(it);
-  documents_.erase(document_id);
-  document_to_word_freqs_.erase(document_id);
+  ForEach(std::execution::par, ordinal_to_term_freqs_[document->second.ordinal],
+          [this](const TermFrequency& term_freq) {
+            inverted_index_.RemoveDocumentFreq(term_freq.term);
+          }
+   );
+
+  EraseDocumentData(document_id);
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::RemoveDocumentsImpl(const ExecutionPolicy& policy, const vector<int>& document_ids) {
+  LatencyTimer timer(*metrics_, Operation::REMOVE_DOCUMENTS);
+  vector<InvertedIndex::TermId> removed_terms;
+
+  for (const int document_id : document_ids) {
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end())
+      continue;
+
+    for (const auto& [term, _] : ordinal_to_term_freqs_[document->second.ordinal]) {
+      removed_terms.push_back(term);
+    }
+
+    EraseDocumentData(document_id);
+  }
 
-  std::vector<const std::string*> words;
+  sort(removed_terms.begin(), removed_terms.end());
 
-  for (const auto& [word, _] : word_to_document_freqs_) {
-    words.push_back(&word);
+  vector<size_t> term_begins;
+  for (size_t i = 0; i < removed_terms.size(); ++i) {
+    if (i == 0 || removed_terms[i] != removed_terms[i - 1])
+      term_begins.push_back(i);
   }
+  term_begins.push_back(removed_terms.size());
 
-  for_each(std::execution::par,
-           words.begin(), words.end(),
-           [&](const std::string* word){word_to_document_freqs_.at(*word).erase(document_id);}
-   );
+  vector<size_t> term_groups(term_begins.size() - 1);
+  iota(term_groups.begin(), term_groups.end(), 0);
+
+  ForEach(policy, term_groups, [this, &removed_terms, &term_begins](size_t group) {
+    inverted_index_.RemoveDocumentFreq(removed_terms[term_begins[group]],
+                                       term_begins[group + 1] - term_begins[group]);
+  });
+
+  if (NeedsCompaction())
+    CompactImpl(policy);
 }
 
-vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
-  return FindTopDocuments(std::execution::seq, raw_query,
-                          [status](int document_id, DocumentStatus document_status, int rating) {
-                            return document_status == status;
-                          });
+bool SearchServer::NeedsCompaction() const noexcept {
+  static constexpr size_t MIN_COMPACTION_SIZE = 256;
+
+  // когда удалённых больше, чем живых, стоимость сжатия распределяется по удалениям,
+  // а списки вхождений остаются не длиннее двойного размера
+  return removed_ordinal_count_ >= MIN_COMPACTION_SIZE && removed_ordinal_count_ > documents_.size();
 }
 
-vector<Document> SearchServer::FindTopDocuments(string_view raw_query) const {
-  return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+void SearchServer::Compact() {
+  CompactImpl(std::execution::seq);
+}
+
+void SearchServer::Compact(const std::execution::sequenced_policy&) {
+  CompactImpl(std::execution::seq);
+}
+
+void SearchServer::Compact(const std::execution::parallel_policy&) {
+  CompactImpl(std::execution::par);
 }
 
-const std::map<string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
-  auto document_id_to_word_freqs = document_to_word_freqs_.find(document_id);
-  std::map<string_view, double> result;
+template<typename ExecutionPolicy>
+void SearchServer::CompactImpl(const ExecutionPolicy& policy) {
+  if (removed_ordinal_count_ == 0)
+    return;
+
+  vector<size_t> new_ordinals(ordinal_to_document_id_.size(), InvertedIndex::NO_ORDINAL);
+  size_t live_count = 0;
+  for (size_t ordinal = 0; ordinal < ordinal_to_document_id_.size(); ++ordinal) {
+    const int document_id = ordinal_to_document_id_[ordinal];
+    if (document_id == NO_DOCUMENT)
+      continue;
 
-  for (const auto& [word, freqs] : (*document_id_to_word_freqs).second) {
-    result.emplace(word, freqs);
+    new_ordinals[ordinal] = live_count;
+    // документы до первого удалённого остаются на месте; перемещение вектора в себя его опустошает
+    if (ordinal != live_count) {
+      ordinal_to_document_id_[live_count] = document_id;
+      ordinal_to_term_freqs_[live_count] = move(ordinal_to_term_freqs_[ordinal]);
+      ordinal_to_metadata_[live_count] = ordinal_to_metadata_[ordinal];
+      documents_.at(document_id).ordinal = live_count;
+    }
+    ++live_count;
   }
-  return ((document_id_to_word_freqs != document_to_word_freqs_.end()) ? result : empty_map_);
+  ordinal_to_document_id_.resize(live_count);
+  ordinal_to_term_freqs_.resize(live_count);
+  ordinal_to_metadata_.resize(live_count);
+
+  vector<InvertedIndex::TermId> terms(inverted_index_.GetTermCount());
+  iota(terms.begin(), terms.end(), 0);
+  ForEach(policy, terms, [this, &new_ordinals](InvertedIndex::TermId term) {
+    inverted_index_.CompactPostings(term, new_ordinals);
+  });
+
+  removed_ordinal_count_ = 0;
 }
 
-tuple<std::vector<string_view>, DocumentStatus> SearchServer::MatchDocument(string_view raw_query, int document_id) const {
-  if (!IsValidWord(raw_query))
-    throw std::invalid_argument("request has invalid character"s);
+void SearchServer::RemoveDocuments(const vector<int>& document_ids) {
+  RemoveDocumentsImpl(std::execution::seq, document_ids);
+}
 
-  if (!documents_.count(document_id))
-    throw std::out_of_range("noexist id"s);
+void SearchServer::RemoveDocuments(const std::execution::sequenced_policy&, const vector<int>& document_ids) {
+  RemoveDocumentsImpl(std::execution::seq, document_ids);
+}
+
+void SearchServer::RemoveDocuments(const std::execution::parallel_policy&, const vector<int>& document_ids) {
+  RemoveDocumentsImpl(std::execution::par, document_ids);
+}
 
-  std::vector<std::string_view> matched_words;
-  const auto query = ParseQuery(raw_query);
+QueryBatchResult SearchServer::FindTopDocumentsBatch(const vector<string>& raw_queries,
+                                                     DocumentStatus status,
+                                                     size_t max_result_count) const {
+  return FindTopDocumentsBatch(IteratorRange(raw_queries.begin(), raw_queries.end()), status, max_result_count);
+}
+
+QueryBatchResult SearchServer::FindTopDocumentsBatch(IteratorRange<vector<string>::const_iterator> raw_queries,
+                                                     DocumentStatus status,
+                                                     size_t max_result_count) const {
+  static constexpr size_t QUERY_BLOCK_SIZE = 64;
 
-  if (!IsValidMinusWord(query.minus_words))
-    throw std::invalid_argument("incorrect syntax of the minus word"s);
+  const size_t query_count = raw_queries.size();
+  vector<Query> queries(query_count);
+  thread_pool_->ParallelFor(query_count, [this, &raw_queries, &queries](size_t i) {
+    ParseQuery(raw_queries.begin()[i], queries[i]);
+  });
 
-  for (const auto& word : query.plus_words) {
-    if (!word_to_document_freqs_.count(sv_to_s(word)))
+  // Запросы, для которых подходит MaxScore, выгоднее считать по отдельности с отсечением.
+  // Остальные группируются по самому длинному списку вхождений, чтобы общие слова попадали в один блок
+  vector<pair<size_t, size_t>> heaviest_terms;
+  vector<size_t> pruned_queries;
+  for (size_t i = 0; i < query_count; ++i) {
+    if (ShouldUseMaxScore(queries[i], max_result_count)) {
+      pruned_queries.push_back(i);
       continue;
+    }
 
-    if (word_to_document_freqs_.at(sv_to_s(word)).count(document_id))
-      matched_words.push_back(word);
+    size_t heaviest_term = InvertedIndex::NO_TERM;
+    size_t heaviest_size = 0;
+    for (const auto& [_, term] : queries[i].plus_terms) {
+      if (term != InvertedIndex::NO_TERM && inverted_index_.GetPostings(term).size() >= heaviest_size) {
+        heaviest_term = term;
+        heaviest_size = inverted_index_.GetPostings(term).size();
+      }
+    }
+    heaviest_terms.emplace_back(heaviest_term, i);
+  }
+  sort(heaviest_terms.begin(), heaviest_terms.end());
+
+  vector<vector<size_t>> blocks;
+  for (size_t i = 0; i < heaviest_terms.size(); ++i) {
+    if (i % QUERY_BLOCK_SIZE == 0)
+      blocks.emplace_back();
+    blocks.back().push_back(heaviest_terms[i].second);
+  }
+  const size_t shared_block_count = blocks.size();
+  for (const size_t query_index : pruned_queries) {
+    blocks.push_back({query_index});
+  }
+
+  vector<vector<Document>> block_documents(blocks.size());
+  vector<vector<size_t>> block_counts(blocks.size());
+
+  thread_pool_->ParallelFor(blocks.size(), [&](size_t block) {
+    if (block >= shared_block_count) {
+      TopDocuments top_documents(max_result_count);
+      auto document_predicate = [status](int, DocumentStatus document_status, int) {
+        return document_status == status;
+      };
+      FindDocumentsInRange(queries[blocks[block][0]], document_predicate, 0, ordinal_to_document_id_.size(),
+                           top_documents);
+      block_documents[block] = top_documents.Extract();
+      block_counts[block] = {block_documents[block].size()};
+      return;
+    }
+
+    vector<const Query*> block_queries;
+    for (const size_t query_index : blocks[block]) {
+      block_queries.push_back(&queries[query_index]);
+    }
+    FindTopDocumentsBlock(block_queries, status, max_result_count, block_documents[block], block_counts[block]);
+  });
+
+  vector<size_t> offsets(query_count + 1, 0);
+  vector<pair<size_t, size_t>> query_positions(query_count);
+  for (size_t block = 0; block < blocks.size(); ++block) {
+    size_t position = 0;
+    for (size_t slot = 0; slot < blocks[block].size(); ++slot) {
+      const size_t query_index = blocks[block][slot];
+      offsets[query_index + 1] = block_counts[block][slot];
+      query_positions[query_index] = {block, position};
+      position += block_counts[block][slot];
+    }
+  }
+  partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+  vector<Document> documents(offsets.back());
+  for (size_t i = 0; i < query_count; ++i) {
+    const auto [block, position] = query_positions[i];
+    const auto first = block_documents[block].begin() + position;
+    copy(first, first + (offsets[i + 1] - offsets[i]), documents.begin() + offsets[i]);
   }
 
-  for (const auto& word : query.minus_words) {
-    if (!word_to_document_freqs_.count(sv_to_s(word)))
+  return {move(documents), move(offsets)};
+}
+
+void SearchServer::FindTopDocumentsBlock(const vector<const Query*>& queries,
+                                         DocumentStatus status,
+                                         size_t max_result_count,
+                                         vector<Document>& documents,
+                                         vector<size_t>& counts) const {
+  static constexpr size_t ORDINAL_BLOCK_SIZE = 4096;
+
+  struct TermGroup {
+    InvertedIndex::TermId term;
+    double inverse_document_freq;
+    // номера запросов блока, в которых встречается слово
+    vector<size_t> slots;
+    PostingList::const_iterator position;
+    PostingList::const_iterator end;
+  };
+
+  // слова просматриваются по алфавиту, как и в FindTopDocuments, поэтому релевантность складывается
+  // в том же порядке и совпадает до бита
+  const auto make_groups = [this, &queries](auto query_terms) {
+    vector<pair<InvertedIndex::TermId, size_t>> entries;
+    for (size_t slot = 0; slot < queries.size(); ++slot) {
+      for (const auto& [_, term] : query_terms(*queries[slot])) {
+        if (term != InvertedIndex::NO_TERM)
+          entries.emplace_back(term, slot);
+      }
+    }
+    sort(entries.begin(), entries.end(), [this](const auto& lhs, const auto& rhs) {
+      const auto lhs_word = inverted_index_.GetWord(lhs.first);
+      const auto rhs_word = inverted_index_.GetWord(rhs.first);
+      return lhs_word < rhs_word || (lhs_word == rhs_word && lhs.second < rhs.second);
+    });
+
+    vector<TermGroup> groups;
+    for (const auto& [term, slot] : entries) {
+      if (groups.empty() || groups.back().term != term) {
+        const auto& postings = inverted_index_.GetPostings(term);
+        groups.push_back({term, GetWordInverseDocumentFreq(term), {}, postings.begin(), postings.end()});
+      }
+      groups.back().slots.push_back(slot);
+    }
+    return groups;
+  };
+
+  auto plus_groups = make_groups([](const Query& query) -> const vector<QueryTerm>& {
+    return query.plus_terms;
+  });
+  auto minus_groups = make_groups([](const Query& query) -> const vector<QueryTerm>& {
+    return query.minus_terms;
+  });
+
+  auto& accumulators = GetThreadBatchAccumulators(queries.size());
+  vector<TopDocuments> top_documents(queries.size(), TopDocuments(max_result_count));
+  const size_t ordinal_count = ordinal_to_document_id_.size();
+  size_t scanned_count = 0;
+  size_t scored_count = 0;
+
+  for (size_t range_begin = 0; range_begin < ordinal_count; range_begin += ORDINAL_BLOCK_SIZE) {
+    const size_t range_end = min(range_begin + ORDINAL_BLOCK_SIZE, ordinal_count);
+    for (size_t slot = 0; slot < queries.size(); ++slot) {
+      accumulators[slot].Reset(ORDINAL_BLOCK_SIZE);
+    }
+
+    for (auto& group : minus_groups) {
+      for (; group.position != group.end && group.position->document_ordinal < range_end; ++group.position) {
+        for (const size_t slot : group.slots) {
+          accumulators[slot].Exclude(group.position->document_ordinal - range_begin);
+        }
+        ++scanned_count;
+      }
+    }
+
+    bool has_scores = false;
+    for (auto& group : plus_groups) {
+      for (; group.position != group.end && group.position->document_ordinal < range_end; ++group.position) {
+        ++scanned_count;
+        const int document_id = ordinal_to_document_id_[group.position->document_ordinal];
+        if (document_id == NO_DOCUMENT || ordinal_to_metadata_[group.position->document_ordinal].status != status)
+          continue;
+
+        const size_t local_ordinal = group.position->document_ordinal - range_begin;
+        const double relevance = group.position->term_freq * group.inverse_document_freq;
+        for (const size_t slot : group.slots) {
+          if (!accumulators[slot].IsExcluded(local_ordinal)) {
+            accumulators[slot].Add(local_ordinal, relevance);
+            has_scores = true;
+          }
+        }
+      }
+    }
+
+    if (!has_scores)
       continue;
 
-    if (word_to_document_freqs_.at(sv_to_s(word)).count(document_id)) {
-      matched_words.clear();
-      break;
+    for (size_t slot = 0; slot < queries.size(); ++slot) {
+      accumulators[slot].ForEachScored([&, slot](size_t local_ordinal, double relevance) {
+        const int document_id = ordinal_to_document_id_[range_begin + local_ordinal];
+        top_documents[slot].Add({document_id, relevance, ordinal_to_metadata_[range_begin + local_ordinal].rating});
+        ++scored_count;
+      });
     }
   }
 
-  return {matched_words, documents_.at(document_id).status};
+  metrics_->Increment(Counter::POSTINGS_SCANNED, scanned_count);
+  metrics_->Increment(Counter::DOCUMENTS_SCORED, scored_count);
+
+  for (auto& query_top : top_documents) {
+    const auto query_documents = query_top.Extract();
+    counts.push_back(query_documents.size());
+    documents.insert(documents.end(), query_documents.begin(), query_documents.end());
+  }
+}
+
+vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+  return FindTopDocuments(std::execution::seq, raw_query, status);
+}
+
+vector<Document> SearchServer::FindTopDocuments(string_view raw_query) const {
+  return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+}
+
+WordFrequenciesView SearchServer::GetWordFrequencies(int document_id) const {
+  const auto document = documents_.find(document_id);
+
+  if (document == documents_.end())
+    return {};
+
+  return {inverted_index_, ordinal_to_term_freqs_[document->second.ordinal]};
+}
+
+tuple<std::vector<string_view>, DocumentStatus> SearchServer::MatchDocument(string_view raw_query, int document_id) const {
+  LatencyTimer timer(*metrics_, Operation::MATCH_DOCUMENT);
+  // запрос разбирается до проверки id, чтобы ошибка в запросе сообщалась в первую очередь
+  ThreadLocalBuffer<Query> query;
+  ParseQuery(raw_query, *query);
+  return MatchParsedQuery(*query, document_id);
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
@@ -206,83 +796,141 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
                                                                                         int document_id
  ) const
 {
-  if (!IsValidWord(std::execution::par, raw_query))
-    throw std::invalid_argument("request has invalid character"s);
-
-  if (!documents_.count(document_id))
-    throw std::out_of_range("noexist id"s);
-
-  std::vector<std::string_view> matched_words;
-  const auto query = ParseQuery(raw_query);
+  // слова одного документа сопоставляются за один проход, распараллеливать здесь нечего
+  return SearchServer::MatchDocument(raw_query, document_id);
+}
 
-  if (!IsValidMinusWord(query.minus_words))
-    throw std::invalid_argument("incorrect syntax of the minus word"s);
+template<typename ExecutionPolicy>
+vector<tuple<vector<string_view>, DocumentStatus>> SearchServer::MatchDocumentsImpl(const ExecutionPolicy& policy,
+                                                                                    string_view raw_query,
+                                                                                    const vector<int>& document_ids) const {
+  ThreadLocalBuffer<Query> query_buffer;
+  const Query& query = *query_buffer;
+  ParseQuery(raw_query, *query_buffer);
+
+  for (const int document_id : document_ids) {
+    if (!documents_.count(document_id))
+      throw std::out_of_range("noexist id"s);
+  }
 
-  for (const auto& word : query.plus_words) {
-    if (!word_to_document_freqs_.count(sv_to_s(word)))
-      continue;
+  vector<tuple<vector<string_view>, DocumentStatus>> result(document_ids.size());
+  vector<size_t> indexes(document_ids.size());
+  iota(indexes.begin(), indexes.end(), 0);
 
-    if (word_to_document_freqs_.at(sv_to_s(word)).count(document_id))
-      matched_words.push_back(word);
-  }
+  ForEach(policy, indexes, [this, &query, &document_ids, &result](size_t i) {
+    result[i] = MatchParsedQuery(query, document_ids[i]);
+  });
 
-  for (const auto& word : query.minus_words) {
-    if (!word_to_document_freqs_.count(sv_to_s(word)))
-      continue;
+  return result;
+}
 
-    if (word_to_document_freqs_.at(sv_to_s(word)).count(document_id)) {
-      matched_words.clear();
-      break;
-    }
-  }
+vector<tuple<vector<string_view>, DocumentStatus>> SearchServer::MatchDocuments(string_view raw_query,
+                                                                                const vector<int>& document_ids) const {
+  return MatchDocumentsImpl(std::execution::seq, raw_query, document_ids);
+}
 
-  return {matched_words, documents_.at(document_id).status};
+vector<tuple<vector<string_view>, DocumentStatus>> SearchServer::MatchDocuments(const std::execution::sequenced_policy&,
+                                                                                string_view raw_query,
+                                                                                const vector<int>& document_ids) const {
+  return MatchDocumentsImpl(std::execution::seq, raw_query, document_ids);
 }
 
-bool SearchServer::IsStopWord(std::string_view word) const {
-  return stop_words_.count(sv_to_s(word));
+vector<tuple<vector<string_view>, DocumentStatus>> SearchServer::MatchDocuments(const std::execution::parallel_policy&,
+                                                                                string_view raw_query,
+                                                                                const vector<int>& document_ids) const {
+  return MatchDocumentsImpl(std::execution::par, raw_query, document_ids);
 }
 
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchParsedQuery(const Query& query, int document_id) const {
+  const auto document = documents_.find(document_id);
+  if (document == documents_.end())
+    throw std::out_of_range("noexist id"s);
 
-bool SearchServer::IsValidMinusWord(const set<string_view>& minus_words) {
-  for (const auto& w : minus_words) {
-    if (w.empty() || w[0] == '-')
-      return false;
+  const size_t document_ordinal = document->second.ordinal;
+  const auto& term_freqs = ordinal_to_term_freqs_[document_ordinal];
+  const DocumentStatus status = ordinal_to_metadata_[document_ordinal].status;
+
+  // слова документа и запроса упорядочены по алфавиту, поэтому позиция поиска только растёт
+  const auto contains = [this, &term_freqs](auto& position, InvertedIndex::TermId term) {
+    position = lower_bound(position, term_freqs.end(), inverted_index_.GetWord(term),
+                           [this](const TermFrequency& term_freq, string_view word) {
+                             return inverted_index_.GetWord(term_freq.term) < word;
+                           });
+    return position != term_freqs.end() && position->term == term;
+  };
+
+  auto position = term_freqs.begin();
+  for (const auto& [_, term] : query.minus_terms) {
+    if (term != InvertedIndex::NO_TERM && contains(position, term))
+      return {vector<string_view>{}, status};
   }
 
-  return true;
-}
+  vector<string_view> matched_words;
+  position = term_freqs.begin();
+  for (const auto& [_, term] : query.plus_terms) {
+    if (term != InvertedIndex::NO_TERM && contains(position, term))
+      matched_words.push_back(inverted_index_.GetWord(term));
+  }
 
-bool SearchServer::IsValidWord(const std::execution::sequenced_policy&, std::string_view word) const {
-  return none_of(std::execution::seq, word.begin(), word.end(), [](char c) {
-    return c >= '\0' && c < ' ';
-  });
+  return {matched_words, status};
 }
 
-bool SearchServer::IsValidWord(std::string_view word) const {
-  return SearchServer::IsValidWord(std::execution::seq, word);
+bool SearchServer::IsStopWord(std::string_view word) const {
+  return stop_words_.find(word) != stop_words_.end();
 }
 
-bool SearchServer::IsValidWord(const std::execution::parallel_policy&, std::string_view word) const {
-  return none_of(std::execution::par, word.begin(), word.end(), [](char c) {
+
+bool SearchServer::IsValidWord(std::string_view word) const {
+  return none_of(word.begin(), word.end(), [](char c) {
     return c >= '\0' && c < ' ';
   });
 }
 
 vector<string_view> SearchServer::SplitIntoWordsNoStop(string_view text) const {
   vector<string_view> words;
-  for (const auto& word : SplitIntoWords(text)) {
-    if (!IsValidWord(word)) {
-      throw invalid_argument("Word "s + sv_to_s(word) + " is invalid"s);
-    }
-
-    if (!IsStopWord(sv_to_s(word)))
+  const auto invalid_word = ForEachWord(text, [this, &words](string_view word) {
+    if (!IsStopWord(word))
       words.push_back(word);
+  });
+
+  if (invalid_word) {
+    throw invalid_argument("Word "s + sv_to_s(*invalid_word) + " is invalid"s);
   }
 
   return words;
 }
 
+void SearchServer::EraseDocumentData(int document_id) {
+  const auto document = documents_.find(document_id);
+  const size_t position = document->second.position;
+
+  // последний id переносится на место удаляемого, чтобы не сдвигать вектор
+  const int last_document_id = document_ids_.back();
+  document_ids_[position] = last_document_id;
+  documents_.at(last_document_id).position = position;
+  document_ids_.pop_back();
+
+  auto& fingerprint_document_ids = fingerprint_to_document_ids_.at(document->second.fingerprint);
+  fingerprint_document_ids.erase(find(fingerprint_document_ids.begin(), fingerprint_document_ids.end(), document_id));
+  if (fingerprint_document_ids.empty())
+    fingerprint_to_document_ids_.erase(document->second.fingerprint);
+
+  ordinal_to_document_id_[document->second.ordinal] = NO_DOCUMENT;
+  ++removed_ordinal_count_;
+  ordinal_to_term_freqs_[document->second.ordinal] = {};
+  documents_.erase(document);
+  UpdateDocumentCount();
+}
+
+uint64_t SearchServer::ComputeWordSetFingerprint(const vector<TermFrequency>& term_freqs) {
+  uint64_t fingerprint = term_freqs.size();
+  for (const auto& [term, _] : term_freqs) {
+    fingerprint ^= term + 0x9e3779b97f4a7c15ULL + (fingerprint << 6) + (fingerprint >> 2);
+  }
+
+  return fingerprint;
+}
+
 int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
   if (ratings.empty())
     return 0;
@@ -295,6 +943,66 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
   return rating_sum / static_cast<int>(ratings.size());
 }
 
+vector<RelevanceAccumulator>& SearchServer::GetThreadBatchAccumulators(size_t count) {
+  static thread_local vector<RelevanceAccumulator> accumulators;
+  if (accumulators.size() < count)
+    accumulators.resize(count);
+
+  return accumulators;
+}
+
+bool SearchServer::ShouldUseMaxScore(const Query& query, size_t max_result_count) const {
+  // на каждый документ-кандидат MaxScore перебирает курсоры всех основных слов,
+  // поэтому на длинных запросах он медленнее полного подсчёта
+  static constexpr size_t MAX_PLUS_TERMS = 16;
+  static constexpr size_t MIN_POSTINGS_PER_RESULT = 64;
+
+  if (max_result_count == 0)
+    return false;
+
+  // наибольший вклад слова и длина его списка вхождений
+  array<pair<double, size_t>, MAX_PLUS_TERMS> terms;
+  size_t term_count = 0;
+  size_t posting_count = 0;
+  double max_upper_bound = 0.0;
+  for (const auto& [_, term] : query.plus_terms) {
+    if (term == InvertedIndex::NO_TERM)
+      continue;
+    if (term_count == MAX_PLUS_TERMS)
+      return false;
+
+    const double upper_bound = inverted_index_.GetMaxTermFreq(term) * GetWordInverseDocumentFreq(term);
+    const size_t term_posting_count = inverted_index_.GetPostings(term).size();
+    terms[term_count++] = {upper_bound, term_posting_count};
+    posting_count += term_posting_count;
+    max_upper_bound = max(max_upper_bound, upper_bound);
+  }
+
+  if (posting_count / MIN_POSTINGS_PER_RESULT < max_result_count)
+    return false;
+
+  // Слова с наименьшими вкладами, которые вместе не дотягивают до сильнейшего слова, скорее всего
+  // станут неосновными, и их списки будут пропускаться поиском. Если так пропускается меньше
+  // половины вхождений, отсечение не окупает свои накладные расходы
+  sort(terms.begin(), terms.begin() + term_count);
+  double bound_sum = 0.0;
+  size_t skipped_count = 0;
+  for (size_t i = 0; i < term_count; ++i) {
+    bound_sum += terms[i].first;
+    if (bound_sum >= max_upper_bound)
+      break;
+    skipped_count += terms[i].second;
+  }
+
+  return skipped_count >= posting_count / 2;
+}
+
+size_t SearchServer::GetShardCount(size_t ordinal_count) const {
+  static constexpr size_t MIN_SHARD_SIZE = 1024;
+
+  return clamp<size_t>(ordinal_count / MIN_SHARD_SIZE, 1, thread_pool_->GetConcurrency());
+}
+
 SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
   if (text.empty())
     throw invalid_argument("Query word is empty"s);
@@ -306,30 +1014,76 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
     text.remove_prefix(1);
   }
 
-  if (text.empty() || text[0] == '-' || !IsValidWord(text)) {
+  if (text.empty() || text[0] == '-') {
     throw invalid_argument("Query word "s + sv_to_s(text) + " is invalid");
   }
 
   return {text, is_minus, IsStopWord(text)};
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
-  Query result;
+void SearchServer::ParseQuery(std::string_view text, Query& result) const {
+  result.plus_terms.clear();
+  result.minus_terms.clear();
 
-  for (const auto& word : SplitIntoWords(text)) {
+  auto invalid_word = ForEachWord(text, [this, &result](string_view word) {
     auto query_word = ParseQueryWord(word);
     if (!query_word.is_stop) {
       if (query_word.is_minus) {
-        result.minus_words.insert(string_view(query_word.data));
+        result.minus_terms.push_back({query_word.data, InvertedIndex::NO_TERM});
       } else {
-        result.plus_words.insert(string_view(query_word.data));
+        result.plus_terms.push_back({query_word.data, InvertedIndex::NO_TERM});
       }
     }
+  });
+
+  if (invalid_word) {
+    if (invalid_word->size() > 1 && (*invalid_word)[0] == '-')
+      invalid_word->remove_prefix(1);
+
+    throw invalid_argument("Query word "s + sv_to_s(*invalid_word) + " is invalid");
   }
 
-  return result;
+  for (auto* terms : {&result.plus_terms, &result.minus_terms}) {
+    sort(terms->begin(), terms->end(), [](const QueryTerm& lhs, const QueryTerm& rhs) {
+      return lhs.word < rhs.word;
+    });
+    terms->erase(unique(terms->begin(), terms->end(), [](const QueryTerm& lhs, const QueryTerm& rhs) {
+      return lhs.word == rhs.word;
+    }), terms->end());
+
+    for (auto& query_term : *terms) {
+      query_term.term = inverted_index_.FindTerm(query_term.word);
+    }
+  }
+}
+
+void SearchServer::UpdateDocumentCount() {
+  log_document_count_ = log(GetDocumentCount() * 1.0);
+  generation_ = NewGeneration();
+}
+
+void SearchServer::SetResultCacheCapacity(size_t capacity) {
+  result_cache_ = make_shared<QueryResultCache>(capacity);
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const string& word) const {
-  return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+uint64_t SearchServer::NewGeneration() {
+  static atomic<uint64_t> next_generation = 0;
+  return next_generation.fetch_add(1, memory_order_relaxed);
+}
+
+string SearchServer::MakeResultCacheKey(const Query& query, DocumentStatus status, size_t max_result_count) const {
+  string key = to_string(static_cast<int>(status)) + ' ' + to_string(max_result_count) + '\n';
+
+  // слова запроса не содержат пробелов и управляющих символов, поэтому ключ однозначен
+  for (const auto* terms : {&query.plus_terms, &query.minus_terms}) {
+    for (const auto& [word, term] : *terms) {
+      if (term != InvertedIndex::NO_TERM) {
+        key += word;
+        key += ' ';
+      }
+    }
+    key += '\n';
+  }
+
+  return key;
 }
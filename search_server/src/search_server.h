@@ -1,36 +1,73 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <map>
+#include <numeric>
+#include <ostream>
 #include <execution>
+#include <istream>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <utility>
-#include <future>
+#include <memory>
 
+#include "binary_io.h"
 #include "document.h"
+#include "inverted_index.h"
+#include "query_batch_result.h"
+#include "query_result_cache.h"
 #include "string_processing.h"
-#include "log_duration.h"
-#include "concurrent_map.h"
+#include "top_documents.h"
+#include "metrics.h"
+#include "relevance_accumulator.h"
+#include "thread_pool.h"
+#include "thread_local_buffer.h"
+#include "word_frequencies.h"
 
 using namespace std::literals;
 
 constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
+constexpr size_t DEFAULT_RESULT_CACHE_CAPACITY = 4096;
 
 class SearchServer {
  public:
+  // concurrency — число потоков для параллельных операций, 0 означает число аппаратных потоков
   template<typename StringContainer>
-  explicit SearchServer(const StringContainer& stop_words);
+  explicit SearchServer(const StringContainer& stop_words, size_t concurrency = 0);
 
-  explicit SearchServer(const std::string& stop_words_text)
-      : SearchServer(SplitIntoWords(stop_words_text))
+  explicit SearchServer(const std::string& stop_words_text, size_t concurrency = 0)
+      : SearchServer(SplitIntoWords(stop_words_text), concurrency)
   {
   }
 
+  ThreadPool& GetThreadPool() const noexcept {
+    return *thread_pool_;
+  }
+
+  // Длительности операций и счётчики работы поиска; копии сервера пишут в общие метрики
+  Metrics& GetMetrics() const noexcept {
+    return *metrics_;
+  }
+
+  // Кеш результатов FindTopDocuments по статусу. Любое изменение документов начинает новое
+  // поколение индекса, и посчитанные раньше результаты перестают возвращаться
+  QueryResultCache& GetResultCache() const noexcept {
+    return *result_cache_;
+  }
+
+  // Заменяет кеш результатов пустым указанной ёмкости; 0 отключает кеширование
+  void SetResultCacheCapacity(size_t capacity);
+
   int GetDocumentCount() const noexcept {
     return documents_.size();
   }
@@ -57,12 +94,54 @@ class SearchServer {
                    DocumentStatus status,
                    const std::vector<int>& ratings);
 
-  const std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+  // Добавляет пачку документов: тексты разбираются параллельно в частичные индексы,
+  // которые затем сливаются в общий за один проход. Если хотя бы один документ некорректен,
+  // исключение выбрасывается до изменения индекса
+  void AddDocuments(const std::vector<NewDocument>& documents);
+  void AddDocuments(const std::execution::sequenced_policy&, const std::vector<NewDocument>& documents);
+  void AddDocuments(const std::execution::parallel_policy&, const std::vector<NewDocument>& documents);
+
+  // Файл индекса начинается с сигнатуры и номера версии формата
+  static constexpr std::string_view INDEX_MAGIC = "SSINDEX\0"sv;
+  static constexpr uint32_t INDEX_VERSION = 1;
+
+  // Сохраняет индекс в двоичном виде: словарь, списки вхождений, прямой индекс и данные документов
+  void SaveIndex(std::ostream& out) const;
+
+  // Восстанавливает сервер из данных SaveIndex без повторного разбора текстов.
+  // Выбрасывает invalid_argument, если данные повреждены или записаны другой версией формата
+  static SearchServer OpenIndex(std::istream& in, size_t concurrency = 0);
+
+  // Возвращает частоты слов документа без копирования; для несуществующего документа — пустое представление
+  WordFrequenciesView GetWordFrequencies(int document_id) const;
+
+  // Возвращает по возрастанию id документов, набор слов которых совпадает
+  // с набором слов документа с меньшим id
+  std::vector<int> FindDuplicates() const;
 
   void RemoveDocument(int document_id);
   void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
   void RemoveDocument(const std::execution::parallel_policy&, int document_id);
 
+  // Удаляет пачку документов, обрабатывая список вхождений каждого слова один раз.
+  // Если после этого NeedsCompaction(), индекс сразу сжимается
+  void RemoveDocuments(const std::vector<int>& document_ids);
+  void RemoveDocuments(const std::execution::sequenced_policy&, const std::vector<int>& document_ids);
+  void RemoveDocuments(const std::execution::parallel_policy&, const std::vector<int>& document_ids);
+
+  // Удаление только помечает номер документа, а его вхождения остаются в инвертированном индексе
+  // и пропускаются поиском. Сжатие убирает их и нумерует документы подряд. Оно проходит по всему
+  // индексу, поэтому RemoveDocument его не запускает, чтобы не задерживать отдельное удаление:
+  // тот, кто удаляет по одному документу, сам вызывает Compact(), когда NeedsCompaction() вернёт true.
+  // RemoveDocuments сжимает индекс сам, и его стоимость распределяется по удалённым документам
+  bool NeedsCompaction() const noexcept;
+
+  void Compact();
+  void Compact(const std::execution::sequenced_policy&);
+  void Compact(const std::execution::parallel_policy&);
+
+  // Возвращает слова запроса, найденные в документе, по алфавиту, или пустой список, если в документе есть минус-слово.
+  // Слова указывают в словарь сервера и действительны всё время его жизни
   std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
   std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&,
                                                                           std::string_view raw_query,
@@ -71,10 +150,22 @@ class SearchServer {
                                                                           std::string_view raw_query,
                                                                           int document_id) const;
 
+  // Сопоставляет запрос с каждым документом из списка, разбирая запрос один раз.
+  // Если хотя бы одного документа нет, выбрасывает out_of_range
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+      std::string_view raw_query, const std::vector<int>& document_ids) const;
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+      const std::execution::sequenced_policy&, std::string_view raw_query, const std::vector<int>& document_ids) const;
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+      const std::execution::parallel_policy&, std::string_view raw_query, const std::vector<int>& document_ids) const;
+
+  // Результаты поиска по статусу кешируются, поиск с произвольным предикатом считается каждый раз
   std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
   std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
 
+  // Предикат вызывается во время поиска и может сам искать на этом же сервере:
+  // у каждого вложенного поиска свои буферы запроса и релевантности
   template<typename DocumentPredicate>
   std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
 
@@ -89,87 +180,211 @@ class SearchServer {
   template<typename DocumentPredicate, typename ExecutionPolicy>
   std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
                                          std::string_view raw_query,
-                                         DocumentPredicate document_predicate) const;
+                                         DocumentPredicate document_predicate,
+                                         size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+  // Ищет по пачке запросов сразу. Запросы с общими словами обрабатываются блоками, так что список
+  // вхождений слова просматривается один раз на блок; запросы, для которых выгоднее отсечение MaxScore,
+  // считаются по отдельности. Блоки выполняются параллельно.
+  // Результат каждого запроса совпадает с FindTopDocuments(raw_query, status)
+  QueryBatchResult FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                         DocumentStatus status = DocumentStatus::ACTUAL,
+                                         size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+  QueryBatchResult FindTopDocumentsBatch(IteratorRange<std::vector<std::string>::const_iterator> raw_queries,
+                                         DocumentStatus status = DocumentStatus::ACTUAL,
+                                         size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
  private:
-  struct DocumentData {
+  // Данные документа, которые нужны при оценке каждого вхождения, хранятся отдельно
+  // плотным столбцом по порядковому номеру, чтобы поиск не обращался к хеш-таблице документов
+  struct DocumentMetadata {
     int rating;
     DocumentStatus status;
   };
 
+  struct DocumentData {
+    size_t ordinal;
+    // позиция в document_ids_
+    size_t position;
+    uint64_t fingerprint;
+  };
+
+  // Индекс части пачки документов с собственной нумерацией слов
+  struct PartialIndex {
+    std::vector<std::string_view> words;
+    std::vector<PostingList> postings;
+  };
+
   struct QueryWord {
     std::string_view data;
     bool is_minus;
     bool is_stop;
   };
 
+  struct QueryTerm {
+    std::string_view word;
+    // NO_TERM, если слова нет в индексе
+    InvertedIndex::TermId term;
+  };
+
+  // Слова каждого вида упорядочены по алфавиту и не повторяются
   struct Query {
-    std::set<std::string_view> plus_words;
-    std::set<std::string_view> minus_words;
+    std::vector<QueryTerm> plus_terms;
+    std::vector<QueryTerm> minus_terms;
   };
 
   std::set<std::string, std::less<>> stop_words_;
-  std::map<std::string, std::map<int, double>, std::less<>> word_to_document_freqs_;
-  std::map<int, std::map<std::string, double, std::less<>>> document_to_word_freqs_;
-  std::map<std::string_view, double> empty_map_ = {};
-  std::map<int, DocumentData> documents_;
+  InvertedIndex inverted_index_;
+  std::unordered_map<int, DocumentData> documents_;
   std::vector<int> document_ids_;
-
-  static bool IsValidMinusWord(const std::set<std::string_view>& minus_words);
+  // Порядковые номера документов в индексе не переиспользуются до сжатия, у удалённых id равен NO_DOCUMENT
+  std::vector<int> ordinal_to_document_id_;
+  std::vector<DocumentMetadata> ordinal_to_metadata_;
+  // Число удалённых документов, вхождения которых ещё остаются в инвертированном индексе
+  size_t removed_ordinal_count_ = 0;
+  // IDF слова считается как log_document_count_ минус логарифм числа документов со словом
+  double log_document_count_ = -std::numeric_limits<double>::infinity();
+  // Прямой индекс: слова документа, упорядоченные по алфавиту
+  std::vector<std::vector<TermFrequency>> ordinal_to_term_freqs_;
+  // Документы с одинаковым набором слов попадают в одну группу
+  std::unordered_map<uint64_t, std::vector<int>> fingerprint_to_document_ids_;
+  std::shared_ptr<ThreadPool> thread_pool_;
+  std::shared_ptr<Metrics> metrics_;
+  // Копии сервера делят кеш, поэтому поколения берутся из общего для всех серверов счётчика
+  // и у разных версий индекса не совпадают
+  std::shared_ptr<QueryResultCache> result_cache_;
+  uint64_t generation_ = NewGeneration();
+
+  static constexpr int NO_DOCUMENT = -1;
 
   static int ComputeAverageRating(const std::vector<int>& ratings);
 
+  static uint64_t NewGeneration();
+
+  // Ключ кеша: слова запроса, которые есть в индексе, статус и число результатов.
+  // Слов, которых нет в индексе, в ключе нет: в этом поколении они не влияют на результат
+  std::string MakeResultCacheKey(const Query& query, DocumentStatus status, size_t max_result_count) const;
+
+  // Ожидает слова, упорядоченные по идентификатору и без повторов
+  static uint64_t ComputeWordSetFingerprint(const std::vector<TermFrequency>& term_freqs);
+
+  // Накопители для блока запросов пакетного поиска, по одному на запрос
+  static std::vector<RelevanceAccumulator>& GetThreadBatchAccumulators(size_t count);
+
+  // Оценивает блок запросов и дописывает их результаты в documents, а число результатов — в counts
+  void FindTopDocumentsBlock(const std::vector<const Query*>& queries,
+                             DocumentStatus status,
+                             size_t max_result_count,
+                             std::vector<Document>& documents,
+                             std::vector<size_t>& counts) const;
+
+  // Число независимых диапазонов документов для параллельного поиска
+  size_t GetShardCount(size_t ordinal_count) const;
+
   bool IsStopWord(std::string_view word) const;
 
   bool IsValidWord(std::string_view word) const;
-  bool IsValidWord(const std::execution::sequenced_policy&, std::string_view word) const;
-  bool IsValidWord(const std::execution::parallel_policy&, std::string_view word) const;
 
   std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
 
+  // Удаляет всё, что известно о документе, кроме его вхождений в инвертированный индекс
+  void EraseDocumentData(int document_id);
+
+  template<typename ExecutionPolicy>
+  void AddDocumentsImpl(const ExecutionPolicy& policy, const std::vector<NewDocument>& documents);
+
+  template<typename ExecutionPolicy>
+  void RemoveDocumentsImpl(const ExecutionPolicy& policy, const std::vector<int>& document_ids);
+
+  template<typename ExecutionPolicy>
+  void CompactImpl(const ExecutionPolicy& policy);
+
   QueryWord ParseQueryWord(std::string_view text) const;
 
-  Query ParseQuery(std::string_view text) const;
+  // Сопоставляет разобранный запрос со словами документа из прямого индекса
+  std::tuple<std::vector<std::string_view>, DocumentStatus> MatchParsedQuery(const Query& query, int document_id) const;
 
-  double ComputeWordInverseDocumentFreq(const std::string& word) const;
+  template<typename ExecutionPolicy>
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocumentsImpl(
+      const ExecutionPolicy& policy, std::string_view raw_query, const std::vector<int>& document_ids) const;
+
+  // Разбирает запрос в result, переиспользуя его память; обычно result — ThreadLocalBuffer<Query>
+  void ParseQuery(std::string_view text, Query& result) const;
+
+  double GetWordInverseDocumentFreq(InvertedIndex::TermId term) const {
+    return log_document_count_ - inverted_index_.GetLogDocumentFreq(term);
+  }
+
+  // Пересчитывает IDF-составляющую числа документов и начинает новое поколение индекса
+  void UpdateDocumentCount();
 
   template <typename ExecutionPolicy, typename ForwardRange, typename Function>
-  static void ForEach(const ExecutionPolicy& policy, ForwardRange& range, Function function);
+  void ForEach(const ExecutionPolicy& policy, ForwardRange& range, Function function) const;
 
   template<typename DocumentPredicate, typename ExecutionPolicy>
   std::vector<Document> FindAllDocuments(const ExecutionPolicy& policy,
                                          const Query& query,
-                                         DocumentPredicate document_predicate) const;
+                                         DocumentPredicate document_predicate,
+                                         size_t max_result_count) const;
+
+  // Оценивает документы с порядковыми номерами из [ordinal_begin, ordinal_end)
+  template<typename DocumentPredicate>
+  void FindDocumentsInRange(const Query& query,
+                            DocumentPredicate& document_predicate,
+                            size_t ordinal_begin,
+                            size_t ordinal_end,
+                            TopDocuments& top_documents) const;
+
+  // MaxScore выгоден, когда вхождений намного больше, чем нужно результатов
+  bool ShouldUseMaxScore(const Query& query, size_t max_result_count) const;
+
+  // То же, что FindDocumentsInRange, но документы обходятся по возрастанию номера, а слова,
+  // суммарный вклад которых не дотягивает до худшего из найденных, только уточняют оценку уже найденных
+  // кандидатов. Результат совпадает с полным подсчётом
+  template<typename DocumentPredicate>
+  void FindDocumentsInRangeMaxScore(const Query& query,
+                                    DocumentPredicate& document_predicate,
+                                    size_t ordinal_begin,
+                                    size_t ordinal_end,
+                                    TopDocuments& top_documents) const;
 };
 
 void RemoveDuplicates(SearchServer& search_server);
 
 template <typename ExecutionPolicy, typename ForwardRange, typename Function>
-void SearchServer::ForEach(const ExecutionPolicy& policy, ForwardRange& range, Function function) {
-  if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>
-      || std::is_same_v<typename std::iterator_traits<typename ForwardRange::iterator>::iterator_category,
-                        std::random_access_iterator_tag>
-  ) {
+void SearchServer::ForEach(const ExecutionPolicy& policy, ForwardRange& range, Function function) const {
+  using Iterator = decltype(range.begin());
+
+  if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
     std::for_each(policy, range.begin(), range.end(), function);
+  } else if constexpr (std::is_same_v<typename std::iterator_traits<Iterator>::iterator_category,
+                                      std::random_access_iterator_tag>) {
+    const Iterator first = range.begin();
+    thread_pool_->ParallelFor(std::size(range), [first, &function](size_t i) {
+      function(first[i]);
+    });
   } else {
-    static constexpr int PART_COUNT = 8;
-    const auto part_length = std::size(range) / PART_COUNT;
-    auto part_begin = range.begin();
-    auto part_end = std::next(part_begin, part_length);
-
-    std::vector<std::future<void>> futures;
-    for (int i = 0; i < PART_COUNT;
-        ++i, part_begin = part_end, part_end =
-            (i == PART_COUNT - 1) ? range.end() : next(part_begin, part_length)) {
-      futures.push_back(std::async([function, part_begin, part_end] {
-        for_each(part_begin, part_end, function);
-      }));
+    const size_t part_count = std::min(thread_pool_->GetConcurrency(), std::size(range));
+    const size_t part_length = (part_count > 0) ? std::size(range) / part_count : 0;
+
+    std::vector<Iterator> part_bounds = {range.begin()};
+    for (size_t i = 1; i < part_count; ++i) {
+      part_bounds.push_back(std::next(part_bounds.back(), part_length));
     }
+    part_bounds.push_back(range.end());
+
+    thread_pool_->ParallelFor(part_count, [&part_bounds, &function](size_t part) {
+      std::for_each(part_bounds[part], part_bounds[part + 1], function);
+    });
   }
 }
 
 template<typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words) {
+SearchServer::SearchServer(const StringContainer& stop_words, size_t concurrency)
+    : thread_pool_(std::make_shared<ThreadPool>(concurrency)),
+      metrics_(std::make_shared<Metrics>()),
+      result_cache_(std::make_shared<QueryResultCache>(DEFAULT_RESULT_CACHE_CAPACITY))
+{
   for (const auto& s : stop_words) {
     if (!IsValidWord(s))
       throw std::invalid_argument("stop word has invalid character"s);
@@ -192,10 +407,34 @@ std::vector<Document> SearchServer::FindTopDocuments(
                                                   DocumentStatus status
  ) const
 {
-  return FindTopDocuments(policy, raw_query,
-                          [status](int document_id, DocumentStatus document_status, int rating) {
-                            return document_status == status;
-                          });
+  LatencyTimer timer(*metrics_, Operation::FIND_TOP_DOCUMENTS);
+  ThreadLocalBuffer<Query> query_buffer;
+  const Query& query = *query_buffer;
+  ParseQuery(raw_query, *query_buffer);
+
+  const auto find_documents = [this, &policy, &query, status] {
+    return FindAllDocuments(policy, query,
+                            [status](int document_id, DocumentStatus document_status, int rating) {
+                              return document_status == status;
+                            },
+                            MAX_RESULT_DOCUMENT_COUNT);
+  };
+
+  // без кеша ключ не строится, чтобы разбор и поиск обходились без выделения памяти
+  if (result_cache_->GetCapacity() == 0)
+    return find_documents();
+
+  std::string key = MakeResultCacheKey(query, status, MAX_RESULT_DOCUMENT_COUNT);
+  if (auto documents = result_cache_->Find(key, generation_)) {
+    metrics_->Increment(Counter::CACHE_HITS);
+    return std::move(*documents);
+  }
+  metrics_->Increment(Counter::CACHE_MISSES);
+
+  auto documents = find_documents();
+  result_cache_->Insert(std::move(key), generation_, documents);
+
+  return documents;
 }
 
 template<typename ExecutionPolicy>
@@ -207,87 +446,266 @@ template<typename DocumentPredicate, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(
                                                        const ExecutionPolicy& policy,
                                                        std::string_view raw_query,
-                                                       DocumentPredicate document_predicate
+                                                       DocumentPredicate document_predicate,
+                                                       size_t max_result_count
  ) const
 {
-  const auto query = ParseQuery(raw_query);
-
-  auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-
-  sort(matched_documents.begin(), matched_documents.end(),
-       [](const Document& lhs, const Document& rhs) {
-         if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-           return lhs.rating > rhs.rating;
-         } else {
-           return lhs.relevance > rhs.relevance;
-         }
-       });
+  LatencyTimer timer(*metrics_, Operation::FIND_TOP_DOCUMENTS);
+  ThreadLocalBuffer<Query> query;
+  ParseQuery(raw_query, *query);
 
-  if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-    matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-  }
-
-  return matched_documents;
+  return FindAllDocuments(policy, *query, document_predicate, max_result_count);
 }
 
 template<typename DocumentPredicate, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindAllDocuments(
                                                        const ExecutionPolicy& policy,
                                                        const Query& query,
-                                                       DocumentPredicate document_predicate
+                                                       DocumentPredicate document_predicate,
+                                                       size_t max_result_count
  ) const
 {
-  std::map<int, double> document_to_relevance;
+  const size_t ordinal_count = ordinal_to_document_id_.size();
 
   if constexpr (std::is_same_v<ExecutionPolicy, std::execution::parallel_policy>) {
-    ConcurrentMap<int, double> con_document_to_relevance(8);
+    const size_t shard_count = GetShardCount(ordinal_count);
+    std::vector<TopDocuments> shard_top_documents(shard_count, TopDocuments(max_result_count));
+    std::vector<size_t> shards(shard_count);
+    iota(shards.begin(), shards.end(), 0);
+
+    ForEach(policy, shards, [&](size_t shard) {
+      FindDocumentsInRange(query, document_predicate,
+                           ordinal_count * shard / shard_count,
+                           ordinal_count * (shard + 1) / shard_count,
+                           shard_top_documents[shard]);
+    });
+
+    TopDocuments top_documents(max_result_count);
+    for (auto& shard_top : shard_top_documents) {
+      for (const Document& document : shard_top.Extract()) {
+        top_documents.Add(document);
+      }
+    }
 
-    auto function = [&con_document_to_relevance, this, &document_predicate](const auto& word){
-                        if (!word_to_document_freqs_.count(sv_to_s(word))) {
-                          return;
-                        }
+    return top_documents.Extract();
+  } else {
+    TopDocuments top_documents(max_result_count);
+    FindDocumentsInRange(query, document_predicate, 0, ordinal_count, top_documents);
+
+    return top_documents.Extract();
+  }
+}
 
-                        const double inverse_document_freq = ComputeWordInverseDocumentFreq(sv_to_s(word));
-                        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(sv_to_s(word))) {
-                          const auto& document_data = documents_.at(document_id);
-                          if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                            con_document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;;
-                          }
-                        }
-                      };
+template<typename DocumentPredicate>
+void SearchServer::FindDocumentsInRange(
+                                          const Query& query,
+                                          DocumentPredicate& document_predicate,
+                                          size_t ordinal_begin,
+                                          size_t ordinal_end,
+                                          TopDocuments& top_documents
+ ) const
+{
+  if (ShouldUseMaxScore(query, top_documents.GetMaxCount())) {
+    FindDocumentsInRangeMaxScore(query, document_predicate, ordinal_begin, ordinal_end, top_documents);
+    return;
+  }
 
-    SearchServer::ForEach(policy, query.plus_words, function);
+  ThreadLocalBuffer<RelevanceAccumulator> accumulator_buffer;
+  RelevanceAccumulator& accumulator = *accumulator_buffer;
+  accumulator.Reset(ordinal_to_document_id_.size());
+  size_t scanned_count = 0;
 
-    document_to_relevance = move(con_document_to_relevance.BuildOrdinaryMap());
-  } else {
-      for (const auto& word : query.plus_words) {
-        if (!word_to_document_freqs_.count(sv_to_s(word)))
-          continue;
-
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(sv_to_s(word));
-
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(sv_to_s(word))) {
-          const auto& document_data = documents_.at(document_id);
-          if (document_predicate(document_id, document_data.status, document_data.rating)) {
-            document_to_relevance[document_id] += term_freq * inverse_document_freq;
-          }
-        }
-      }
+  for (const auto& [_, term] : query.minus_terms) {
+    if (term == InvertedIndex::NO_TERM)
+      continue;
+
+    const auto& postings = inverted_index_.GetPostings(term);
+    for (auto it = InvertedIndex::LowerBound(postings, ordinal_begin);
+         it != postings.end() && it->document_ordinal < ordinal_end; ++it) {
+      accumulator.Exclude(it->document_ordinal);
+      ++scanned_count;
+    }
   }
 
-  for (const auto& word : query.minus_words) {
-    if (!word_to_document_freqs_.count(sv_to_s(word)))
+  for (const auto& [_, term] : query.plus_terms) {
+    if (term == InvertedIndex::NO_TERM)
       continue;
 
-    for (const auto [document_id, _] : word_to_document_freqs_.at(sv_to_s(word))) {
-      document_to_relevance.erase(document_id);
+    const double inverse_document_freq = GetWordInverseDocumentFreq(term);
+    const auto& postings = inverted_index_.GetPostings(term);
+    for (auto it = InvertedIndex::LowerBound(postings, ordinal_begin);
+         it != postings.end() && it->document_ordinal < ordinal_end; ++it) {
+      ++scanned_count;
+      if (accumulator.IsExcluded(it->document_ordinal))
+        continue;
+
+      const int document_id = ordinal_to_document_id_[it->document_ordinal];
+      if (document_id == NO_DOCUMENT)
+        continue;
+
+      const auto& metadata = ordinal_to_metadata_[it->document_ordinal];
+      if (document_predicate(document_id, metadata.status, metadata.rating)) {
+        accumulator.Add(it->document_ordinal, it->term_freq * inverse_document_freq);
+      }
     }
   }
 
-  std::vector<Document> matched_documents;
-  for (const auto [document_id, relevance] : document_to_relevance) {
-    matched_documents.push_back( {document_id, relevance, documents_.at(document_id).rating});
+  size_t scored_count = 0;
+  accumulator.ForEachScored([this, &top_documents, &scored_count](size_t document_ordinal, double relevance) {
+    const int document_id = ordinal_to_document_id_[document_ordinal];
+    top_documents.Add({document_id, relevance, ordinal_to_metadata_[document_ordinal].rating});
+    ++scored_count;
+  });
+
+  metrics_->Increment(Counter::POSTINGS_SCANNED, scanned_count);
+  metrics_->Increment(Counter::DOCUMENTS_SCORED, scored_count);
+}
+
+template<typename DocumentPredicate>
+void SearchServer::FindDocumentsInRangeMaxScore(
+                                                  const Query& query,
+                                                  DocumentPredicate& document_predicate,
+                                                  size_t ordinal_begin,
+                                                  size_t ordinal_end,
+                                                  TopDocuments& top_documents
+ ) const
+{
+  struct TermCursor {
+    PostingList::const_iterator position;
+    PostingList::const_iterator end;
+    double inverse_document_freq;
+    double upper_bound;
+    // номер слова в запросе: вклады складываются в порядке слов, как при полном подсчёте
+    size_t query_index;
+  };
+
+  const auto make_cursor = [this, ordinal_begin, ordinal_end](InvertedIndex::TermId term, size_t query_index) {
+    const auto& postings = inverted_index_.GetPostings(term);
+    const double inverse_document_freq = GetWordInverseDocumentFreq(term);
+    return TermCursor{InvertedIndex::LowerBound(postings, ordinal_begin),
+                      InvertedIndex::LowerBound(postings, ordinal_end),
+                      inverse_document_freq,
+                      inverted_index_.GetMaxTermFreq(term) * inverse_document_freq,
+                      query_index};
+  };
+
+  std::vector<TermCursor> plus_cursors;
+  for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+    if (query.plus_terms[i].term != InvertedIndex::NO_TERM)
+      plus_cursors.push_back(make_cursor(query.plus_terms[i].term, i));
+  }
+  std::vector<TermCursor> minus_cursors;
+  for (const auto& [_, term] : query.minus_terms) {
+    if (term != InvertedIndex::NO_TERM)
+      minus_cursors.push_back(make_cursor(term, 0));
+  }
+
+  // слова упорядочены по возрастанию вклада; bound_prefix[i] — наибольший суммарный вклад первых i слов
+  sort(plus_cursors.begin(), plus_cursors.end(), [](const TermCursor& lhs, const TermCursor& rhs) {
+    return lhs.upper_bound < rhs.upper_bound;
+  });
+  std::vector<double> bound_prefix(plus_cursors.size() + 1, 0.0);
+  for (size_t i = 0; i < plus_cursors.size(); ++i) {
+    bound_prefix[i + 1] = bound_prefix[i] + plus_cursors[i].upper_bound;
+  }
+
+  // сдвиги курсоров и поиски по спискам вхождений
+  size_t scanned_count = 0;
+  size_t scored_count = 0;
+  const auto seek = [&scanned_count](TermCursor& cursor, size_t document_ordinal) {
+    ++scanned_count;
+    cursor.position = std::lower_bound(cursor.position, cursor.end, document_ordinal,
+                                       [](const Posting& posting, size_t ordinal) {
+                                         return posting.document_ordinal < ordinal;
+                                       });
+    return cursor.position != cursor.end && cursor.position->document_ordinal == document_ordinal;
+  };
+
+  // Документ, набравший меньше threshold, не вытеснит худший из найденных. Запас покрывает
+  // погрешность сложения, чтобы не отбросить документ, который полный подсчёт оставил бы
+  double threshold = -std::numeric_limits<double>::infinity();
+  // слова [0, first_essential) не могут сами по себе дать документу пройти порог
+  size_t first_essential = 0;
+  const auto update_threshold = [&] {
+    if (!top_documents.IsFull())
+      return;
+
+    const double worst = top_documents.GetWorstRelevance();
+    threshold = worst - RELEVANCE_EPSILON - std::abs(worst) * 1e-12;
+    first_essential = 0;
+    while (first_essential < plus_cursors.size() && bound_prefix[first_essential + 1] < threshold) {
+      ++first_essential;
+    }
+  };
+  update_threshold();
+
+  std::vector<double> contributions(query.plus_terms.size());
+  size_t next_ordinal = ordinal_begin;
+  while (true) {
+    size_t candidate = InvertedIndex::NO_ORDINAL;
+    for (size_t i = first_essential; i < plus_cursors.size(); ++i) {
+      auto& cursor = plus_cursors[i];
+      // слово, вернувшееся в основные после снижения порога, могло отстать от уже рассмотренных документов
+      if (cursor.position != cursor.end && cursor.position->document_ordinal < next_ordinal)
+        seek(cursor, next_ordinal);
+      if (cursor.position != cursor.end)
+        candidate = std::min(candidate, cursor.position->document_ordinal);
+    }
+    if (candidate == InvertedIndex::NO_ORDINAL)
+      break;
+    next_ordinal = candidate + 1;
+
+    std::fill(contributions.begin(), contributions.end(), 0.0);
+    double estimate = 0.0;
+    for (size_t i = first_essential; i < plus_cursors.size(); ++i) {
+      auto& cursor = plus_cursors[i];
+      if (cursor.position != cursor.end && cursor.position->document_ordinal == candidate) {
+        contributions[cursor.query_index] = cursor.position->term_freq * cursor.inverse_document_freq;
+        estimate += contributions[cursor.query_index];
+        ++cursor.position;
+        ++scanned_count;
+      }
+    }
+
+    bool is_pruned = false;
+    for (size_t i = first_essential; i-- > 0;) {
+      if (estimate + bound_prefix[i + 1] < threshold) {
+        is_pruned = true;
+        break;
+      }
+
+      auto& cursor = plus_cursors[i];
+      if (seek(cursor, candidate)) {
+        contributions[cursor.query_index] = cursor.position->term_freq * cursor.inverse_document_freq;
+        estimate += contributions[cursor.query_index];
+      }
+    }
+    if (is_pruned || estimate < threshold)
+      continue;
+
+    const int document_id = ordinal_to_document_id_[candidate];
+    if (document_id == NO_DOCUMENT)
+      continue;
+
+    const bool is_excluded = std::any_of(minus_cursors.begin(), minus_cursors.end(), [&](TermCursor& cursor) {
+      return seek(cursor, candidate);
+    });
+    if (is_excluded)
+      continue;
+
+    const auto& metadata = ordinal_to_metadata_[candidate];
+    if (!document_predicate(document_id, metadata.status, metadata.rating))
+      continue;
+
+    double relevance = 0.0;
+    for (const double contribution : contributions) {
+      relevance += contribution;
+    }
+    top_documents.Add({document_id, relevance, metadata.rating});
+    ++scored_count;
+    update_threshold();
   }
 
-  return matched_documents;
+  metrics_->Increment(Counter::POSTINGS_SCANNED, scanned_count);
+  metrics_->Increment(Counter::DOCUMENTS_SCORED, scored_count);
 }
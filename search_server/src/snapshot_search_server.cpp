@@ -0,0 +1,20 @@
+#include "snapshot_search_server.h"
+
+using namespace std;
+
+SnapshotSearchServer::SnapshotSearchServer(SearchServer search_server)
+    : current_(make_shared<const SearchServer>(move(search_server)))
+{
+}
+
+void SnapshotSearchServer::AddDocuments(const vector<NewDocument>& documents) {
+  Update([&documents](SearchServer& search_server) {
+    search_server.AddDocuments(std::execution::par, documents);
+  });
+}
+
+void SnapshotSearchServer::RemoveDocuments(const vector<int>& document_ids) {
+  Update([&document_ids](SearchServer& search_server) {
+    search_server.RemoveDocuments(std::execution::par, document_ids);
+  });
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "search_server.h"
+
+// Поисковый сервер, который можно читать во время изменений. Читатели получают неизменяемый снимок
+// и ищут в нём, не дожидаясь писателя; писатель изменяет копию текущей версии и публикует её.
+// Старая версия освобождается, когда её отпустит последний читатель.
+// Публикация и получение снимка идут через std::atomic_load/atomic_store для shared_ptr: в libstdc++
+// они не lock-free и на время копирования указателя берут спинлок из общего пула, но сам поиск
+// в снимке блокировок не берёт.
+// Каждая публикация копирует весь индекс, поэтому изменения принимаются только пачками
+class SnapshotSearchServer {
+ public:
+  using Snapshot = std::shared_ptr<const SearchServer>;
+
+  explicit SnapshotSearchServer(SearchServer search_server);
+
+  // Возвращает текущую версию; снимок не меняется, сколько бы его ни держали
+  Snapshot GetSnapshot() const {
+    return std::atomic_load(&current_);
+  }
+
+  // Применяет modifier(SearchServer&) к копии текущей версии и публикует результат.
+  // Копирование стоит O(размера индекса), поэтому изменения выгодно собирать в один вызов.
+  // Если modifier выбросит исключение, опубликованная версия не меняется
+  template<typename Modifier>
+  void Update(Modifier modifier);
+
+  void AddDocuments(const std::vector<NewDocument>& documents);
+
+  void RemoveDocuments(const std::vector<int>& document_ids);
+
+ private:
+  Snapshot current_;
+  // писатели работают по одному, чтобы не потерять изменения друг друга
+  std::mutex write_mutex_;
+};
+
+template<typename Modifier>
+void SnapshotSearchServer::Update(Modifier modifier) {
+  std::lock_guard lock(write_mutex_);
+
+  auto next = std::make_shared<SearchServer>(*std::atomic_load(&current_));
+  modifier(*next);
+  std::atomic_store(&current_, Snapshot(std::move(next)));
+}
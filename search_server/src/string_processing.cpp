@@ -1,5 +1,11 @@
 #include "string_processing.h"
 
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 string sv_to_s(const string_view sv) {
@@ -33,17 +39,56 @@ int ReadLineWithNumber() {
   return result;
 }
 
+const char* FindSeparatorOrControl(const char* first, const char* last) noexcept {
+  // пробел и управляющие символы — это ровно байты со значением не больше ' '
+#if defined(__AVX2__)
+  const __m256i limit_32 = _mm256_set1_epi8(' ');
+  for (; last - first >= 32; first += 32) {
+    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+    const __m256i is_boundary = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, limit_32), bytes);
+    const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(is_boundary));
+    if (mask != 0)
+      return first + __builtin_ctz(mask);
+  }
+#endif
+
+#if defined(__SSE2__)
+  const __m128i limit_16 = _mm_set1_epi8(' ');
+  for (; last - first >= 16; first += 16) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+    const __m128i is_boundary = _mm_cmpeq_epi8(_mm_min_epu8(bytes, limit_16), bytes);
+    const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(is_boundary));
+    if (mask != 0)
+      return first + __builtin_ctz(mask);
+  }
+#endif
+
+  for (; first != last; ++first) {
+    if (static_cast<unsigned char>(*first) <= static_cast<unsigned char>(' '))
+      return first;
+  }
+
+  return last;
+}
+
 vector<string_view> SplitIntoWords(string_view str) {
     vector<string_view> result;
-    const int64_t pos_end = str.npos;
+    const char* const last = str.data() + str.size();
+    const char* word_begin = str.data();
+    const char* position = word_begin;
+
     while (true) {
-        int64_t space = str.find(' ');
-        result.push_back(space == pos_end ? str.substr(0) : str.substr(0, space));
-        if (space == pos_end) {
+        position = FindSeparatorOrControl(position, last);
+        if (position != last && *position != ' ') {
+            ++position;
+            continue;
+        }
+
+        result.emplace_back(word_begin, position - word_begin);
+        if (position == last) {
             break;
-        } else {
-            str.remove_prefix(space+1);
         }
+        word_begin = ++position;
     }
 
     return result;
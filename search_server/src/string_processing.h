@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <optional>
 #include <set>
 #include <string>
 #include <string_view>
@@ -20,8 +21,18 @@ std::string ReadLine();
 
 int ReadLineWithNumber();
 
+// Возвращает указатель на первый пробел или управляющий символ (коды 0..32) в [first, last) либо last.
+// Использует SSE2/AVX2, если они доступны при сборке
+const char* FindSeparatorOrControl(const char* first, const char* last) noexcept;
+
 std::vector<std::string_view> SplitIntoWords(std::string_view str);
 
+// Разбивает строку по пробелам и за тот же проход проверяет отсутствие управляющих символов.
+// Вызывает word_handler для каждого слова до первого слова с управляющим символом,
+// которое возвращается; если таких слов нет — возвращается nullopt
+template<typename WordHandler>
+std::optional<std::string_view> ForEachWord(std::string_view str, WordHandler word_handler);
+
 std::ostream& operator<<(std::ostream& out, const Document& document);
 
 template<typename StringContainer>
@@ -43,6 +54,29 @@ std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContain
   return non_empty_strings;
 }
 
+template<typename WordHandler>
+std::optional<std::string_view> ForEachWord(std::string_view str, WordHandler word_handler) {
+  const char* const last = str.data() + str.size();
+  const char* word_begin = str.data();
+
+  while (true) {
+    const char* const boundary = FindSeparatorOrControl(word_begin, last);
+
+    if (boundary != last && *boundary != ' ') {
+      const size_t word_start = word_begin - str.data();
+      const size_t word_end = str.find(' ', boundary - str.data());
+      return str.substr(word_start, (word_end == str.npos) ? str.npos : word_end - word_start);
+    }
+
+    word_handler(std::string_view(word_begin, boundary - word_begin));
+
+    if (boundary == last)
+      return std::nullopt;
+
+    word_begin = boundary + 1;
+  }
+}
+
 template <typename Map>
 bool key_compare(Map const &lhs, Map const &rhs) {
     return lhs.size() == rhs.size()
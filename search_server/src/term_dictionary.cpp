@@ -0,0 +1,76 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+TermDictionary::TermDictionary(const TermDictionary& other) {
+  *this = other;
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+  if (this == &other)
+    return *this;
+
+  chunks_.clear();
+  chunk_position_ = nullptr;
+  chunk_free_ = 0;
+  words_.clear();
+  term_ids_.clear();
+
+  words_.reserve(other.words_.size());
+  term_ids_.reserve(other.words_.size());
+  for (const string_view word : other.words_) {
+    Add(word);
+  }
+
+  return *this;
+}
+
+TermDictionary::TermDictionary(TermDictionary&& other) noexcept {
+  *this = move(other);
+}
+
+TermDictionary& TermDictionary::operator=(TermDictionary&& other) noexcept {
+  chunks_ = move(other.chunks_);
+  chunk_position_ = exchange(other.chunk_position_, nullptr);
+  chunk_free_ = exchange(other.chunk_free_, 0);
+  words_ = move(other.words_);
+  term_ids_ = move(other.term_ids_);
+
+  return *this;
+}
+
+TermDictionary::TermId TermDictionary::Find(string_view word) const {
+  const auto it = term_ids_.find(word);
+  return (it != term_ids_.end()) ? it->second : NO_TERM;
+}
+
+TermDictionary::TermId TermDictionary::Add(string_view word) {
+  if (const auto it = term_ids_.find(word); it != term_ids_.end())
+    return it->second;
+
+  const TermId term = words_.size();
+  const string_view stored_word = Store(word);
+  words_.push_back(stored_word);
+  term_ids_.emplace(stored_word, term);
+
+  return term;
+}
+
+string_view TermDictionary::Store(string_view word) {
+  if (word.size() > chunk_free_) {
+    const size_t chunk_size = max(CHUNK_SIZE, word.size());
+    chunks_.push_back(make_unique<char[]>(chunk_size));
+    chunk_position_ = chunks_.back().get();
+    chunk_free_ = chunk_size;
+  }
+
+  char* const stored = chunk_position_;
+  copy(word.begin(), word.end(), stored);
+  chunk_position_ += word.size();
+  chunk_free_ -= word.size();
+
+  return {stored, word.size()};
+}
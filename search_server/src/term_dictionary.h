@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Словарь слов индекса. Каждое слово хранится один раз в блоках памяти, которые
+// не перемещаются, поэтому string_view на слова остаются действительными всё время жизни словаря
+class TermDictionary {
+ public:
+  using TermId = size_t;
+
+  static constexpr TermId NO_TERM = static_cast<TermId>(-1);
+
+  TermDictionary() = default;
+
+  TermDictionary(const TermDictionary& other);
+  TermDictionary& operator=(const TermDictionary& other);
+
+  TermDictionary(TermDictionary&& other) noexcept;
+  TermDictionary& operator=(TermDictionary&& other) noexcept;
+
+  // Возвращает идентификатор слова или NO_TERM; не выделяет память
+  TermId Find(std::string_view word) const;
+
+  // Возвращает идентификатор слова, добавляя его при необходимости.
+  // Идентификаторы выдаются подряд, начиная с нуля
+  TermId Add(std::string_view word);
+
+  std::string_view GetWord(TermId term) const {
+    return words_[term];
+  }
+
+  size_t size() const noexcept {
+    return words_.size();
+  }
+
+ private:
+  static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  char* chunk_position_ = nullptr;
+  size_t chunk_free_ = 0;
+  std::vector<std::string_view> words_;
+  std::unordered_map<std::string_view, TermId> term_ids_;
+
+  std::string_view Store(std::string_view word);
+};
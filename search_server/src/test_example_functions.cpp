@@ -15,6 +15,79 @@ void AssertImpl(bool value, const std::string& expr_str, const std::string& file
   }
 }
 
+void AssertSameDocuments(const std::vector<Document>& found, const std::vector<Document>& expected,
+                         double relevance_tolerance) {
+  ASSERT_EQUAL(found.size(), expected.size());
+  for (size_t i = 0; i < found.size(); ++i) {
+    const std::string hint = "document #"s + std::to_string(i);
+    ASSERT_EQUAL_HINT(found[i].id, expected[i].id, hint);
+    ASSERT_EQUAL_HINT(found[i].rating, expected[i].rating, hint);
+    ASSERT_HINT(std::abs(found[i].relevance - expected[i].relevance) <= relevance_tolerance, hint);
+  }
+}
+
+IndexImage ReadIndexImage(const std::string& data) {
+  std::istringstream in(data);
+  IndexImage image;
+  image.magic.resize(SearchServer::INDEX_MAGIC.size());
+  in.read(image.magic.data(), image.magic.size());
+  image.version = ReadValue<uint32_t>(in);
+
+  image.stop_words.resize(ReadValue<uint64_t>(in));
+  for (auto& stop_word : image.stop_words) {
+    stop_word = ReadString(in);
+  }
+
+  ReadArray(in, image.ordinal_to_document_id);
+  image.terms.resize(ReadValue<uint64_t>(in));
+  for (auto& [word, postings] : image.terms) {
+    word = ReadString(in);
+    ReadArray(in, postings);
+  }
+  image.ordinal_to_term_freqs.resize(image.ordinal_to_document_id.size());
+  for (auto& term_freqs : image.ordinal_to_term_freqs) {
+    ReadArray(in, term_freqs);
+  }
+
+  ReadArray(in, image.document_ids);
+  ReadArray(in, image.ratings);
+  ReadArray(in, image.statuses);
+  ReadArray(in, image.ordinals);
+  ReadArray(in, image.fingerprints);
+  ASSERT_HINT(in.peek() == std::char_traits<char>::eof(), "Index image must cover the whole file"s);
+
+  return image;
+}
+
+std::string WriteIndexImage(const IndexImage& image) {
+  std::ostringstream out;
+  out.write(image.magic.data(), image.magic.size());
+  WriteValue(out, image.version);
+
+  WriteValue<uint64_t>(out, image.stop_words.size());
+  for (const auto& stop_word : image.stop_words) {
+    WriteString(out, stop_word);
+  }
+
+  WriteArray(out, image.ordinal_to_document_id);
+  WriteValue<uint64_t>(out, image.terms.size());
+  for (const auto& [word, postings] : image.terms) {
+    WriteString(out, word);
+    WriteArray(out, postings);
+  }
+  for (const auto& term_freqs : image.ordinal_to_term_freqs) {
+    WriteArray(out, term_freqs);
+  }
+
+  WriteArray(out, image.document_ids);
+  WriteArray(out, image.ratings);
+  WriteArray(out, image.statuses);
+  WriteArray(out, image.ordinals);
+  WriteArray(out, image.fingerprints);
+
+  return out.str();
+}
+
 void TestAddDocument() {
   const int doc_id = 0;
   const std::string content = "dog cat horse"s;
@@ -172,6 +245,22 @@ void TestComputeRelevance() {
               "Incorrect calculation of relevance"s);
 }
 
+void TestRelevanceFollowsIndexChanges() {
+  SearchServer server(""s);
+  server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+  server.AddDocument(2, "dog"s, DocumentStatus::ACTUAL, {1});
+  ASSERT(std::abs(server.FindTopDocuments("cat"s).at(0).relevance - std::log(2.0)) < EPSILON);
+
+  server.AddDocument(3, "bird"s, DocumentStatus::ACTUAL, {1});
+  ASSERT(std::abs(server.FindTopDocuments("cat"s).at(0).relevance - std::log(3.0)) < EPSILON);
+
+  server.AddDocument(4, "cat bird"s, DocumentStatus::ACTUAL, {1});
+  ASSERT(std::abs(server.FindTopDocuments("cat"s).at(0).relevance - std::log(2.0)) < EPSILON);
+
+  server.RemoveDocuments({2, 3, 4});
+  ASSERT(std::abs(server.FindTopDocuments("cat"s).at(0).relevance) < EPSILON);
+}
+
 void TestRemoveDuplicates() {
   SearchServer server("a the on is"s);
   server.AddDocument(0, "this test"s, DocumentStatus::ACTUAL, {1});
@@ -188,6 +277,43 @@ void TestRemoveDuplicates() {
   }
 }
 
+void TestGetWordFrequencies() {
+  SearchServer server("in"s);
+  server.AddDocument(1, "dog in cat dog"s, DocumentStatus::ACTUAL, {1});
+
+  const auto word_freqs = server.GetWordFrequencies(1);
+  ASSERT_EQUAL(word_freqs.size(), 2u);
+
+  const std::map<std::string_view, double> expected = {{"cat"sv, 1.0 / 3}, {"dog"sv, 2.0 / 3}};
+  const std::map<std::string_view, double> actual(word_freqs.begin(), word_freqs.end());
+  ASSERT_EQUAL(actual, expected);
+  ASSERT_EQUAL((*word_freqs.begin()).first, "cat"sv);
+  static_assert(std::is_same_v<std::iterator_traits<WordFrequenciesView::Iterator>::iterator_category,
+                               std::input_iterator_tag>);
+  ASSERT_EQUAL(std::distance(word_freqs.begin(), word_freqs.end()), 2);
+
+  ASSERT(server.GetWordFrequencies(2).empty());
+}
+
+void TestFindDuplicates() {
+  SearchServer server("and with"s);
+  server.AddDocument(5, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+  server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+  server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+  server.AddDocument(4, "nasty rat and funny pet pet"s, DocumentStatus::ACTUAL, {1, 2});
+  server.AddDocument(1, "rat nasty funny pet"s, DocumentStatus::ACTUAL, {1, 2});
+  server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+
+  ASSERT_EQUAL(server.FindDuplicates(), (std::vector<int>{3, 4, 5}));
+
+  server.RemoveDocument(1);
+  ASSERT_EQUAL(server.FindDuplicates(), (std::vector<int>{3, 5}));
+
+  RemoveDuplicates(server);
+  ASSERT_EQUAL(server.GetDocumentCount(), 3);
+  ASSERT(server.FindDuplicates().empty());
+}
+
 void TestParrallelFindDoc() {
   SearchServer search_server("and with"s);
   std::vector<std::string> str = {"white cat and yellow hat"s,
@@ -221,6 +347,947 @@ void TestParrallelFindDoc() {
   }
 }
 
+void TestRemoveDocument() {
+  SearchServer server(""s);
+  server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+  server.AddDocument(2, "black cat"s, DocumentStatus::ACTUAL, {2});
+  server.AddDocument(3, "white dog"s, DocumentStatus::ACTUAL, {3});
+  server.AddDocument(4, "black dog"s, DocumentStatus::ACTUAL, {4});
+  server.AddDocument(5, "grey mouse"s, DocumentStatus::ACTUAL, {5});
+
+  server.RemoveDocument(2);
+  ASSERT_EQUAL(server.GetDocumentCount(), 4);
+  ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), 1u);
+  ASSERT_EQUAL(server.FindTopDocuments("cat"s).at(0).id, 1);
+
+  server.RemoveDocument(std::execution::par, 3);
+  ASSERT_EQUAL(server.FindTopDocuments("white"s).size(), 1u);
+
+  server.RemoveDocuments({1, 5, 5, 42});
+  ASSERT_EQUAL(server.GetDocumentCount(), 1);
+  ASSERT(server.FindTopDocuments("white cat mouse"s).empty());
+  ASSERT_EQUAL(std::vector<int>(server.begin(), server.end()), std::vector<int>{4});
+
+  server.AddDocument(2, "grey cat"s, DocumentStatus::ACTUAL, {2});
+  ASSERT_EQUAL(server.FindTopDocuments("cat"s).at(0).id, 2);
+  ASSERT(server.FindTopDocuments("black"s).at(0).id == 4);
+
+  server.RemoveDocuments(std::execution::par, {2, 4});
+  ASSERT_EQUAL(server.GetDocumentCount(), 0);
+  ASSERT(server.FindTopDocuments("grey black"s).empty());
+}
+
+void TestFindTopDocumentsResultCount() {
+  SearchServer server(""s);
+  for (int id = 0; id < 10; ++id) {
+    std::string text = "cat"s;
+    for (int i = 0; i < id; ++i) {
+      text += " dog"s;
+    }
+    server.AddDocument(id, text, DocumentStatus::ACTUAL, {id});
+  }
+
+  const auto all_status = [](int document_id, DocumentStatus status, int rating) {
+    return true;
+  };
+
+  const auto all_documents = server.FindTopDocuments(std::execution::seq, "cat"s, all_status, 10);
+  ASSERT_EQUAL(all_documents.size(), 10u);
+  ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+
+  const auto top_documents = server.FindTopDocuments(std::execution::seq, "cat"s, all_status, 3);
+  AssertSameDocuments(top_documents, {all_documents.begin(), all_documents.begin() + 3}, 0.0);
+  ASSERT_EQUAL(top_documents[0].id, 9);
+
+  ASSERT(server.FindTopDocuments(std::execution::par, "cat"s, all_status, 0).empty());
+
+  // огромный K не должен приводить к выделению памяти под K документов
+  const size_t huge_count = std::numeric_limits<size_t>::max();
+  ASSERT_EQUAL(server.FindTopDocuments(std::execution::seq, "cat"s, all_status, huge_count).size(), 10u);
+  ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "cat -dog"s, all_status, huge_count).size(), 1u);
+  ASSERT_EQUAL(server.FindTopDocumentsBatch({"cat"s, "dog"s}, DocumentStatus::ACTUAL, huge_count).GetDocuments().size(), 19u);
+}
+
+void TestFindTopDocumentsSharded() {
+  const std::vector<std::string> words = {"cat"s, "dog"s, "parrot"s, "fluffy"s, "tail"s, "collar"s, "eyes"s,
+                                          "white"s, "black"s, "rare"s, "small"s};
+  // 3000 документов при трёх потоках делятся на несколько диапазонов, и параллельный поиск сливает их результаты
+  SearchServer server(""s, 3);
+  for (int id = 0; id < 3000; ++id) {
+    std::string text;
+    for (int i = 0; i < 5; ++i) {
+      text += words[(id * (i + 3) + i * i) % words.size()] + " "s;
+    }
+    server.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), {id % 7, id % 5});
+  }
+
+  const auto even = [](int document_id, DocumentStatus, int) {
+    return document_id % 2 == 0;
+  };
+  for (const auto& query : {"cat"s, "fluffy tail -dog"s, "rare small white black"s, "parrot -eyes -collar"s}) {
+    AssertSameDocuments(server.FindTopDocuments(std::execution::par, query),
+                        server.FindTopDocuments(std::execution::seq, query));
+    AssertSameDocuments(server.FindTopDocuments(std::execution::par, query, DocumentStatus::BANNED),
+                        server.FindTopDocuments(std::execution::seq, query, DocumentStatus::BANNED));
+    for (const size_t max_result_count : {1, 5, 50, 5000}) {
+      AssertSameDocuments(server.FindTopDocuments(std::execution::par, query, even, max_result_count),
+                          server.FindTopDocuments(std::execution::seq, query, even, max_result_count));
+    }
+  }
+}
+
+void TestSplitIntoWords() {
+  const std::string long_text = "the quick brown fox jumps over the lazy dog and keeps running far away"s;
+  const std::vector<std::string_view> long_words = {"the"sv, "quick"sv, "brown"sv, "fox"sv, "jumps"sv,
+      "over"sv, "the"sv, "lazy"sv, "dog"sv, "and"sv, "keeps"sv, "running"sv, "far"sv, "away"sv};
+
+  ASSERT_EQUAL(SplitIntoWords(long_text), long_words);
+  ASSERT_EQUAL(SplitIntoWords("a  b"sv), (std::vector<std::string_view>{"a"sv, ""sv, "b"sv}));
+  ASSERT_EQUAL(SplitIntoWords("скво\x01рец"sv), std::vector<std::string_view>{"скво\x01рец"sv});
+
+  std::vector<std::string_view> words;
+  const auto collect = [&words](std::string_view word) {
+    words.push_back(word);
+  };
+
+  ASSERT(!ForEachWord(long_text, collect));
+  ASSERT_EQUAL(words, long_words);
+
+  words.clear();
+  const std::string invalid_text = long_text + " bro\x12ken tail"s;
+  const auto invalid_word = ForEachWord(invalid_text, collect);
+  ASSERT(invalid_word.has_value());
+  ASSERT_EQUAL(*invalid_word, "bro\x12ken"sv);
+  ASSERT_EQUAL(words, long_words);
+
+  SearchServer server(""s);
+  bool thrown = false;
+  try {
+    server.AddDocument(1, long_text + " \x1f"s, DocumentStatus::ACTUAL, {1});
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  ASSERT_HINT(thrown, "Control character in a document must be rejected"s);
+  ASSERT_EQUAL(server.GetDocumentCount(), 0);
+}
+
+void TestNestedSearchInPredicate() {
+  SearchServer server("and"s, 2);
+  for (int id = 0; id < 300; ++id) {
+    server.AddDocument(id, id % 3 ? "fluffy cat and tail"s : "white dog and collar"s, DocumentStatus::ACTUAL, {id});
+  }
+
+  // предикат ищет сам, пока внешний поиск ещё обходит свой запрос; при большом K поиски
+  // идут через накопитель релевантности, а не через MaxScore
+  const size_t max_result_count = 500;
+  const auto nested = [&server, max_result_count](int document_id, DocumentStatus, int) {
+    const auto even = [](int id, DocumentStatus, int) {
+      return id % 2 == 0;
+    };
+    const auto dogs = server.FindTopDocuments(std::execution::seq, "white dog -cat"s, even, max_result_count);
+    return dogs.size() == 50u && document_id % 2 == 1;
+  };
+  const auto odd = [](int document_id, DocumentStatus, int) {
+    return document_id % 2 == 1;
+  };
+
+  for (const auto& query : {"fluffy cat -dog"s, "tail collar"s}) {
+    AssertSameDocuments(server.FindTopDocuments(std::execution::seq, query, nested, max_result_count),
+                        server.FindTopDocuments(std::execution::seq, query, odd, max_result_count));
+    AssertSameDocuments(server.FindTopDocuments(std::execution::par, query, nested, max_result_count),
+                        server.FindTopDocuments(std::execution::par, query, odd, max_result_count));
+  }
+}
+
+void TestAddDocuments() {
+  const std::vector<std::string> texts = {
+      "white cat and fancy collar"s, "fluffy cat fluffy tail"s, "groomed dog expressive eyes"s,
+      "fluffy tail cat"s, "big dog sparrow"s, "white cat and fancy collar"s, ""s, "sparrow sparrow sparrow"s};
+
+  std::vector<NewDocument> batch;
+  for (int i = 0; i < static_cast<int>(texts.size()); ++i) {
+    batch.push_back({i * 2, texts[i], DocumentStatus::ACTUAL, {i, i + 1}});
+  }
+
+  SearchServer expected("and"s, 4);
+  for (const auto& document : batch) {
+    expected.AddDocument(document.id, document.text, document.status, document.ratings);
+  }
+
+  SearchServer seq_server("and"s, 4);
+  seq_server.AddDocuments(std::execution::seq, batch);
+  SearchServer par_server("and"s, 4);
+  par_server.AddDocument(100, "cat on a fence"s, DocumentStatus::BANNED, {5});
+  par_server.RemoveDocument(100);
+  par_server.AddDocuments(std::execution::par, batch);
+
+  for (const SearchServer* server : {&seq_server, &par_server}) {
+    ASSERT_EQUAL(server->GetDocumentCount(), expected.GetDocumentCount());
+    for (const auto& document : batch) {
+      ASSERT(key_compare(server->GetWordFrequencies(document.id), expected.GetWordFrequencies(document.id)));
+    }
+    ASSERT_EQUAL(server->FindDuplicates(), expected.FindDuplicates());
+
+    for (const auto& query : {"fluffy cat"s, "sparrow -big"s, "dog eyes tail"s}) {
+      const auto found = server->FindTopDocuments(query);
+      const auto expected_found = expected.FindTopDocuments(query);
+      AssertSameDocuments(found, expected_found);
+    }
+  }
+
+  // некорректный документ в пачке не должен оставить добавленными остальные
+  for (const auto& invalid : {NewDocument{20, "bro\x12ken"sv}, NewDocument{2, "dog"sv}, NewDocument{21, "dog"sv}}) {
+    std::vector<NewDocument> invalid_batch = {{21, "new dog"sv}, {22, "new cat"sv}, invalid};
+    bool thrown = false;
+    try {
+      par_server.AddDocuments(std::execution::par, invalid_batch);
+    } catch (const std::invalid_argument&) {
+      thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT_EQUAL(par_server.GetDocumentCount(), static_cast<int>(batch.size()));
+    ASSERT(par_server.FindTopDocuments("new"s).empty());
+  }
+}
+
+void TestSaveAndOpenIndex() {
+  SearchServer server("and with"s);
+  server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, {1, 2});
+  server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+  server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, {5, -12, 2, 1});
+  server.AddDocument(4, "fluffy tail with cat"s, DocumentStatus::IRRELEVANT, {9});
+  server.AddDocument(5, "white cat and fancy collar"s, DocumentStatus::ACTUAL, {3});
+  server.RemoveDocument(2);
+
+  std::stringstream stream;
+  server.SaveIndex(stream);
+  const std::string data = stream.str();
+  const SearchServer opened = SearchServer::OpenIndex(stream);
+
+  ASSERT_EQUAL(opened.GetDocumentCount(), server.GetDocumentCount());
+  ASSERT_EQUAL(std::vector<int>(opened.begin(), opened.end()), std::vector<int>(server.begin(), server.end()));
+  ASSERT_EQUAL(opened.FindDuplicates(), std::vector<int>{5});
+  for (const int document_id : server) {
+    ASSERT(key_compare(opened.GetWordFrequencies(document_id), server.GetWordFrequencies(document_id)));
+  }
+
+  const auto status_any = [](int, DocumentStatus, int) {
+    return true;
+  };
+  for (const auto& query : {"fluffy cat"s, "dog -white"s, "tail with"s}) {
+    const auto found = opened.FindTopDocuments(std::execution::seq, query, status_any);
+    const auto expected = server.FindTopDocuments(std::execution::seq, query, status_any);
+    AssertSameDocuments(found, expected);
+  }
+  ASSERT(std::get<1>(opened.MatchDocument("eyes"s, 3)) == DocumentStatus::BANNED);
+
+  const IndexImage image = ReadIndexImage(data);
+  ASSERT_HINT(WriteIndexImage(image) == data, "Index image must reproduce the file"s);
+  const auto corrupt = [&image](auto modifier) {
+    IndexImage broken = image;
+    modifier(broken);
+    return WriteIndexImage(broken);
+  };
+
+  // огромное число стоп-слов, за которым данные обрываются
+  std::ostringstream huge_stop_word_count;
+  huge_stop_word_count.write(image.magic.data(), image.magic.size());
+  WriteValue(huge_stop_word_count, image.version);
+  WriteValue<uint64_t>(huge_stop_word_count, uint64_t{1} << 40);
+  WriteString(huge_stop_word_count, "and"sv);
+
+  // номер удалённого документа 2 становится живым, но ни одному документу не принадлежит
+  ASSERT_EQUAL(image.ordinal_to_document_id.at(1), -1);
+  const std::string unknown_live_ordinal = corrupt([](IndexImage& broken) {
+    broken.ordinal_to_document_id[1] = 999;
+  });
+  const std::string invalid_status = corrupt([](IndexImage& broken) {
+    broken.statuses.front() = static_cast<DocumentStatus>(7);
+  });
+  const std::string wrong_version = corrupt([](IndexImage& broken) {
+    ++broken.version;
+  });
+  // списки вхождений расходятся с прямым индексом: лишнее вхождение, пропавшее вхождение, другая частота
+  const auto find_term = [&image](const std::string& word) {
+    return static_cast<size_t>(std::find_if(image.terms.begin(), image.terms.end(), [&word](const auto& term) {
+      return term.first == word;
+    }) - image.terms.begin());
+  };
+  const size_t dog = find_term("dog"s);
+  const size_t cat = find_term("cat"s);
+  ASSERT(dog < image.terms.size() && cat < image.terms.size());
+  const std::string extra_posting = corrupt([dog](IndexImage& broken) {
+    broken.terms[dog].second.insert(broken.terms[dog].second.begin(), Posting{0, 0.25});
+  });
+  const std::string missing_posting = corrupt([cat](IndexImage& broken) {
+    broken.terms[cat].second.pop_back();
+  });
+  const std::string wrong_term_freq = corrupt([cat](IndexImage& broken) {
+    broken.terms[cat].second.front().term_freq += 0.5;
+  });
+
+  for (const auto& broken : {data.substr(0, data.size() - 1), "X"s + data.substr(1), ""s,
+                             huge_stop_word_count.str(), unknown_live_ordinal, invalid_status, wrong_version,
+                             extra_posting, missing_posting, wrong_term_freq}) {
+    std::istringstream broken_stream(broken);
+    bool thrown = false;
+    try {
+      SearchServer::OpenIndex(broken_stream);
+    } catch (const std::invalid_argument&) {
+      thrown = true;
+    }
+    ASSERT_HINT(thrown, "Broken index data must be rejected"s);
+  }
+}
+
+void TestRemoveDocumentsCompaction() {
+  const std::vector<std::string> words = {"cat"s, "dog"s, "parrot"s, "fluffy"s, "tail"s, "collar"s, "eyes"s};
+  const auto make_text = [&words](int id) {
+    return words[id % words.size()] + " "s + words[id % 5] + " "s + words[(id / 3) % words.size()];
+  };
+
+  SearchServer server(""s, 4);
+  SearchServer expected(""s, 4);
+  for (int id = 0; id < 1000; ++id) {
+    server.AddDocument(id, make_text(id), DocumentStatus::ACTUAL, {id % 10});
+    if (id % 4 == 3)
+      expected.AddDocument(id, make_text(id), DocumentStatus::ACTUAL, {id % 10});
+  }
+
+  std::vector<int> removed;
+  for (int id = 0; id < 1000; ++id) {
+    if (id % 4 == 0) {
+      server.RemoveDocument(std::execution::par, id);
+    } else if (id % 4 == 1) {
+      server.RemoveDocument(id);
+    } else if (id % 4 == 2) {
+      removed.push_back(id);
+    }
+  }
+  // поштучные удаления оставляют сжатие вызывающему, пачка сжимает индекс сама
+  ASSERT(!server.NeedsCompaction());
+  server.RemoveDocuments(std::execution::par, removed);
+  ASSERT(!server.NeedsCompaction());
+
+  for (int id = 1000; id < 1100; ++id) {
+    server.AddDocument(id, make_text(id), DocumentStatus::ACTUAL, {id % 10});
+    expected.AddDocument(id, make_text(id), DocumentStatus::ACTUAL, {id % 10});
+  }
+
+  ASSERT_EQUAL(server.GetDocumentCount(), expected.GetDocumentCount());
+  for (const auto& query : {"cat"s, "fluffy -dog"s, "parrot eyes tail"s}) {
+    const auto found = server.FindTopDocuments(std::execution::par, query);
+    const auto expected_found = expected.FindTopDocuments(query);
+    AssertSameDocuments(found, expected_found);
+  }
+
+  for (int id = 3; id < 1100; id += 4) {
+    const auto [matched, status] = server.MatchDocument(words[id % words.size()], id);
+    ASSERT_EQUAL(matched.size(), 1u);
+  }
+}
+
+void TestSnapshotSearchServer() {
+  SearchServer initial("and"s, 2);
+  initial.AddDocument(0, "cat"s, DocumentStatus::ACTUAL, {1});
+  SnapshotSearchServer server(std::move(initial));
+
+  const auto before = server.GetSnapshot();
+  server.AddDocuments({{1, "white cat"sv, DocumentStatus::ACTUAL, {2}}});
+  ASSERT_EQUAL(before->GetDocumentCount(), 1);
+  ASSERT_EQUAL(before->FindTopDocuments("white"s).size(), 0u);
+  ASSERT_EQUAL(server.GetSnapshot()->FindTopDocuments("white"s).size(), 1u);
+
+  bool thrown = false;
+  try {
+    server.AddDocuments({{2, "dog"sv}, {1, "duplicate id"sv}});
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  ASSERT(thrown);
+  ASSERT_EQUAL(server.GetSnapshot()->GetDocumentCount(), 2);
+
+  // каждый снимок согласован: поиск по общему слову находит все его документы
+  std::atomic<bool> done = false;
+  std::atomic<int> inconsistent_count = 0;
+  std::thread reader([&server, &done, &inconsistent_count] {
+    while (!done) {
+      const auto snapshot = server.GetSnapshot();
+      const auto found = snapshot->FindTopDocuments(std::execution::seq, "cat"s,
+                                                    [](int, DocumentStatus, int) { return true; }, 1000);
+      if (static_cast<int>(found.size()) != snapshot->GetDocumentCount())
+        ++inconsistent_count;
+    }
+  });
+
+  // каждая публикация копирует индекс, поэтому документы добавляются пачками
+  std::vector<std::string> texts(200);
+  std::vector<NewDocument> batch;
+  for (int id = 2; id < 200; ++id) {
+    if (id % 10 == 0) {
+      server.RemoveDocuments({id - 1});
+      continue;
+    }
+    texts[id] = "cat number "s + std::to_string(id);
+    batch.push_back({id, texts[id], DocumentStatus::ACTUAL, {id}});
+    if (id % 10 == 9) {
+      server.AddDocuments(batch);
+      batch.clear();
+    }
+  }
+  done = true;
+  reader.join();
+
+  ASSERT_EQUAL(inconsistent_count.load(), 0);
+  ASSERT_EQUAL(server.GetSnapshot()->GetDocumentCount(), 2 + 198 - 2 * 19);
+}
+
+void TestFindTopDocumentsBatch() {
+  const std::vector<std::string> words = {"cat"s, "dog"s, "parrot"s, "fluffy"s, "tail"s, "collar"s, "eyes"s,
+                                          "white"s, "black"s, "big"s, "small"s, "and"s};
+  SearchServer server("and"s, 4);
+  for (int id = 0; id < 10000; ++id) {
+    std::string text;
+    for (size_t i = 0; i < 6; ++i) {
+      text += words[(id * 7 + i * i * 3 + id / 11) % words.size()] + " "s;
+    }
+    server.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), {id % 17, -(id % 5)});
+  }
+  for (int id = 0; id < 10000; id += 13) {
+    server.RemoveDocument(id);
+  }
+
+  std::vector<std::string> queries;
+  for (size_t i = 0; i < 150; ++i) {
+    std::string query = words[i % words.size()] + " "s + words[(i / 3) % words.size()];
+    if (i % 4 == 0)
+      query += " -"s + words[(i / 5 + 1) % words.size()];
+    if (i % 7 == 0)
+      query += " unknown -absent"s;
+    queries.push_back(query);
+  }
+
+  for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+    const QueryBatchResult batch = server.FindTopDocumentsBatch(queries, status);
+    ASSERT_EQUAL(batch.size(), queries.size());
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+      // релевантность складывается в том же порядке, поэтому совпадает до бита
+      AssertSameDocuments(std::vector<Document>(batch[i].begin(), batch[i].end()),
+                          server.FindTopDocuments(queries[i], status), 0.0);
+    }
+  }
+
+  const auto joined = ProcessQueriesJoined(server, queries);
+  const auto separate = ProcessQueries(server, queries);
+  ASSERT_EQUAL(separate.size(), queries.size());
+  size_t position = 0;
+  for (const auto& documents : separate) {
+    for (const Document& document : documents) {
+      ASSERT_EQUAL(joined.at(position++).id, document.id);
+    }
+  }
+  ASSERT_EQUAL(position, joined.size());
+  ASSERT_EQUAL(server.FindTopDocumentsBatch({}).size(), 0u);
+}
+
+void TestProcessQueriesJoinedLazy() {
+  SearchServer server("and with"s, 3);
+  int id = 0;
+  for (const std::string& text : {"funny pet and nasty rat"s, "funny pet with curly hair"s, "funny pet and not very nasty rat"s,
+                                  "pet with rat and rat and rat"s, "nasty rat with curly hair"s}) {
+    server.AddDocument(++id, text, DocumentStatus::ACTUAL, {1, 2});
+  }
+
+  std::vector<std::string> queries;
+  for (int i = 0; i < 40; ++i) {
+    queries.push_back(i % 3 == 0 ? "nasty rat -not"s : (i % 3 == 1 ? "not very funny nasty pet"s : "curly hair"s));
+  }
+
+  const auto expected = ProcessQueriesJoined(server, queries);
+  for (const size_t window_size : {1, 7, 1000}) {
+    std::vector<Document> found;
+    for (const Document& document : ProcessQueriesJoinedLazy(server, queries, window_size)) {
+      found.push_back(document);
+    }
+
+    AssertSameDocuments(found, expected, 0.0);
+  }
+
+  const std::vector<std::string> no_queries;
+  auto empty = ProcessQueriesJoinedLazy(server, no_queries);
+  ASSERT(empty.begin() == empty.end());
+
+  queries[20] = "broken --query"s;
+  size_t read_count = 0;
+  bool thrown = false;
+  try {
+    for ([[maybe_unused]] const Document& document : ProcessQueriesJoinedLazy(server, queries, 4)) {
+      ++read_count;
+    }
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  ASSERT(thrown);
+  ASSERT(read_count > 0);
+}
+
+void TestFindTopDocumentsMaxScore() {
+  const std::vector<std::string> words = {"cat"s, "dog"s, "parrot"s, "fluffy"s, "tail"s, "collar"s, "eyes"s,
+                                          "white"s, "black"s, "big"s, "small"s, "rare"s};
+  SearchServer server(""s, 2);
+  for (int id = 0; id < 3000; ++id) {
+    std::string text;
+    // частые слова встречаются почти везде, редкие — изредка и с разной частотой
+    for (int i = 0; i < 4 + id % 5; ++i) {
+      text += words[(id * (i + 3) + i * i) % (id % 17 == 0 ? words.size() : 6)] + " "s;
+    }
+    server.AddDocument(id, text, static_cast<DocumentStatus>(id % 4 == 3), {id % 7});
+  }
+  for (int id = 0; id < 3000; id += 29) {
+    server.RemoveDocument(id);
+  }
+
+  const auto all = [](int, DocumentStatus, int) {
+    return true;
+  };
+  const auto odd_actual = [](int document_id, DocumentStatus status, int) {
+    return document_id % 2 == 1 && status == DocumentStatus::ACTUAL;
+  };
+
+  for (const auto& query : {"cat dog"s, "cat dog parrot fluffy tail collar"s, "rare big -cat"s,
+                            "eyes white black small rare"s, "tail -dog -collar"s}) {
+    for (const size_t max_result_count : {1, 3, 10}) {
+      for (const auto policy_is_par : {false, true}) {
+        auto pruned = policy_is_par
+            ? server.FindTopDocuments(std::execution::par, query, odd_actual, max_result_count)
+            : server.FindTopDocuments(std::execution::seq, query, all, max_result_count);
+        auto full = policy_is_par
+            ? server.FindTopDocuments(std::execution::par, query, odd_actual, 1'000'000)
+            : server.FindTopDocuments(std::execution::seq, query, all, 1'000'000);
+        full.resize(std::min(full.size(), max_result_count));
+
+        AssertSameDocuments(pruned, full, 0.0);
+      }
+    }
+  }
+
+  // Отсечение выбирается, только когда может пропустить большую часть вхождений:
+  // слово из всех документов почти ничего не весит, и его список пропускается.
+  // Длинный запрос из равноправных слов считается полностью
+  SearchServer uniform_server(""s);
+  std::string long_query = "w0"s;
+  for (int word = 1; word < 20; ++word) {
+    long_query += " w"s + std::to_string(word);
+  }
+  for (int id = 0; id < 2000; ++id) {
+    uniform_server.AddDocument(id, "common w"s + std::to_string(id % 20) + " w"s + std::to_string(id % 7),
+                               DocumentStatus::ACTUAL, {id % 5});
+  }
+  const auto count_scanned = [&uniform_server, &all](const std::string& query, size_t max_result_count) {
+    const auto& metrics = uniform_server.GetMetrics();
+    const uint64_t before = metrics.GetSnapshot().GetCounter(Counter::POSTINGS_SCANNED);
+    uniform_server.FindTopDocuments(std::execution::seq, query, all, max_result_count);
+    return metrics.GetSnapshot().GetCounter(Counter::POSTINGS_SCANNED) - before;
+  };
+  ASSERT(count_scanned("common w3"s, 1) < count_scanned("common w3"s, 1'000'000) / 2);
+  ASSERT_EQUAL(count_scanned(long_query, 1), count_scanned(long_query, 1'000'000));
+}
+
+void TestStatusAndRatingAfterCompaction() {
+  SearchServer server(""s);
+  for (int id = 0; id < 600; ++id) {
+    server.AddDocument(id, "cat number"s + std::to_string(id), static_cast<DocumentStatus>(id / 10 % 3), {id, id + 2});
+  }
+  // после удаления большинства документов и сжатия номера документов меняются
+  for (int id = 0; id < 600; ++id) {
+    if (id % 10 != 0)
+      server.RemoveDocument(id);
+  }
+  ASSERT(server.NeedsCompaction());
+  server.Compact();
+  ASSERT(!server.NeedsCompaction());
+
+  for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED}) {
+    const auto found = server.FindTopDocuments(std::execution::par, "cat"s, status);
+    ASSERT_EQUAL(found.size(), 5u);
+    for (const Document& document : found) {
+      ASSERT_EQUAL(document.id % 10, 0);
+      ASSERT(static_cast<DocumentStatus>(document.id / 10 % 3) == status);
+      ASSERT_EQUAL(document.rating, document.id + 1);
+    }
+  }
+  ASSERT(server.FindTopDocuments("cat"s, DocumentStatus::REMOVED).empty());
+  ASSERT(std::get<1>(server.MatchDocument("cat"s, 590)) == DocumentStatus::BANNED);
+
+  // документ 0 стоял до первого удалённого и не сдвигался, но его прямой индекс должен сохраниться
+  ASSERT_EQUAL(std::get<0>(server.MatchDocument("cat number0"s, 0)).size(), 2u);
+  ASSERT_EQUAL(server.GetWordFrequencies(0).size(), 2u);
+
+  // удаление документа 0 уменьшает частоту его слов: "cat" остаётся во всех 59 документах
+  server.RemoveDocument(0);
+  const auto found = server.FindTopDocuments("cat number10"s, [](int document_id, DocumentStatus, int) {
+    return document_id == 10;
+  });
+  ASSERT_EQUAL(found.size(), 1u);
+  ASSERT(std::abs(found[0].relevance - 0.5 * std::log(59.0)) < RELEVANCE_EPSILON);
+}
+
+void TestMatchDocuments() {
+  SearchServer server("and with"s, 3);
+  server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+  server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::BANNED, {1, 2});
+  server.AddDocument(3, "big dog and fancy collar"s, DocumentStatus::IRRELEVANT, {1, 2, 3});
+  server.AddDocument(4, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {1, 1});
+
+  const std::vector<int> document_ids = {4, 3, 2, 1, 2};
+  const auto matches = server.MatchDocuments(std::execution::par, "curly -dog nasty funny pet cat"s, document_ids);
+  ASSERT_EQUAL(matches.size(), document_ids.size());
+
+  // слова живут в словаре сервера, поэтому строка запроса уже не нужна
+  const std::vector<std::vector<std::string_view>> expected_words = {
+      {"curly"sv, "nasty"sv}, {}, {"curly"sv, "funny"sv, "pet"sv}, {"funny"sv, "nasty"sv, "pet"sv},
+      {"curly"sv, "funny"sv, "pet"sv}};
+  for (size_t i = 0; i < document_ids.size(); ++i) {
+    const auto& [words, status] = matches[i];
+    ASSERT_EQUAL(words, expected_words[i]);
+
+    const std::string query = "curly -dog nasty funny pet cat"s;
+    const auto [single_words, single_status] = server.MatchDocument(query, document_ids[i]);
+    ASSERT_EQUAL(single_words, words);
+    ASSERT(single_status == status);
+  }
+
+  bool thrown = false;
+  try {
+    server.MatchDocuments("cat"s, {1, 5});
+  } catch (const std::out_of_range&) {
+    thrown = true;
+  }
+  ASSERT_HINT(thrown, "Unknown document id must be rejected"s);
+}
+
+void TestMetrics() {
+  for (size_t bucket = 0; bucket + 1 < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+    const uint64_t upper_bound = LatencyHistogram::GetBucketUpperBound(bucket);
+    ASSERT_EQUAL(LatencyHistogram::GetBucket(upper_bound), bucket);
+    ASSERT_EQUAL(LatencyHistogram::GetBucket(upper_bound + 1), bucket + 1);
+  }
+
+  SearchServer server("and"s, 2);
+  // без кеша каждый поиск доходит до индекса
+  server.SetResultCacheCapacity(0);
+  server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, {1});
+  server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {2});
+  server.AddDocuments({{3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {3}}});
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&server] {
+      for (int j = 0; j < 25; ++j) {
+        server.FindTopDocuments("fluffy cat -collar"s);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  server.FindTopDocuments(std::execution::par, "dog"s);
+  server.MatchDocument("cat"s, 2);
+  server.RemoveDocument(1);
+
+  const auto snapshot = server.GetMetrics().GetSnapshot();
+  ASSERT_EQUAL(snapshot.GetLatency(Operation::FIND_TOP_DOCUMENTS).count, 101u);
+  ASSERT_EQUAL(snapshot.GetLatency(Operation::MATCH_DOCUMENT).count, 1u);
+  ASSERT_EQUAL(snapshot.GetLatency(Operation::ADD_DOCUMENT).count, 2u);
+  ASSERT_EQUAL(snapshot.GetLatency(Operation::ADD_DOCUMENTS).count, 1u);
+  ASSERT_EQUAL(snapshot.GetLatency(Operation::REMOVE_DOCUMENT).count, 1u);
+  // каждый поиск по "fluffy cat -collar" просматривает четыре вхождения и оценивает только документ 2
+  ASSERT_EQUAL(snapshot.GetCounter(Counter::POSTINGS_SCANNED), 100u * 4 + 1);
+  ASSERT_EQUAL(snapshot.GetCounter(Counter::DOCUMENTS_SCORED), 100u + 1);
+
+  const auto& latency = snapshot.GetLatency(Operation::FIND_TOP_DOCUMENTS);
+  ASSERT(latency.GetQuantile(0.5) <= latency.GetQuantile(0.99));
+  ASSERT(latency.GetQuantile(0.99) <= latency.GetQuantile(0.999));
+  ASSERT(latency.GetQuantile(0.999) <= latency.GetQuantile(1.0));
+  ASSERT_EQUAL(snapshot.GetLatency(Operation::REMOVE_DOCUMENTS).GetQuantile(0.5), 0u);
+
+  std::ostringstream out;
+  snapshot.Export(out);
+  ASSERT(out.str().find("find_top_documents_count 101\n"s) != std::string::npos);
+  ASSERT(out.str().find("documents_scored 101\n"s) != std::string::npos);
+}
+
+void TestQueryResultCache() {
+  {
+    QueryResultCache cache(32);
+    ASSERT(!cache.Find("cat"s, 1));
+    cache.Insert("cat"s, 1, {{1, 0.5, 2}});
+    const auto documents = cache.Find("cat"s, 1);
+    ASSERT(documents && documents->size() == 1u && documents->front().id == 1);
+    ASSERT_HINT(!cache.Find("cat"s, 2), "Result of another generation must not be returned"s);
+    ASSERT_EQUAL(cache.GetStats().size, 0u);
+    ASSERT_EQUAL(cache.GetStats().hits, 1u);
+    ASSERT_EQUAL(cache.GetStats().misses, 2u);
+
+    for (int i = 0; i < 1000; ++i) {
+      cache.Insert(std::to_string(i), 1, {});
+    }
+    ASSERT_EQUAL(cache.GetStats().size, cache.GetCapacity());
+
+    for (const size_t capacity : {1u, 5u, 20u}) {
+      QueryResultCache small(capacity);
+      for (int i = 0; i < 100; ++i) {
+        small.Insert(std::to_string(i), 1, {});
+      }
+      ASSERT_EQUAL(small.GetStats().size, capacity);
+    }
+
+    // результат более старого поколения не заменяет и не вытесняет более новый
+    cache.Insert("dog"s, 5, {{5, 0.5, 5}});
+    cache.Insert("dog"s, 4, {{4, 0.5, 4}});
+    ASSERT(!cache.Find("dog"s, 4));
+    const auto newest = cache.Find("dog"s, 5);
+    ASSERT(newest && newest->size() == 1u && newest->front().id == 5);
+    cache.Insert("dog"s, 6, {{6, 0.5, 6}});
+    ASSERT(!cache.Find("dog"s, 5));
+    ASSERT(cache.Find("dog"s, 6));
+
+    QueryResultCache disabled(0);
+    disabled.Insert("cat"s, 1, {});
+    ASSERT(!disabled.Find("cat"s, 1));
+  }
+
+  SearchServer server("and"s, 2);
+  server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, {1});
+  server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {2});
+  server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, {3});
+
+  const auto ids = [](const std::vector<Document>& documents) {
+    std::vector<int> result;
+    for (const auto& document : documents) {
+      result.push_back(document.id);
+    }
+    return result;
+  };
+
+  ASSERT_EQUAL(ids(server.FindTopDocuments("fluffy cat"s)), std::vector<int>({2, 1}));
+  // тот же запрос с повтором, стоп-словом и неизвестным словом нормализуется к тому же ключу
+  ASSERT_EQUAL(ids(server.FindTopDocuments(std::execution::par, "cat and fluffy parrot cat"s)), std::vector<int>({2, 1}));
+  ASSERT_EQUAL(server.GetResultCache().GetStats().hits, 1u);
+  ASSERT(server.FindTopDocuments("fluffy cat"s, DocumentStatus::BANNED).empty());
+  ASSERT_EQUAL(server.GetResultCache().GetStats().hits, 1u);
+
+  const SearchServer copy = server;
+  server.AddDocument(4, "fluffy parrot"s, DocumentStatus::ACTUAL, {4});
+  ASSERT_EQUAL(ids(server.FindTopDocuments("fluffy cat"s)), std::vector<int>({2, 4, 1}));
+  ASSERT_EQUAL(ids(copy.FindTopDocuments("fluffy cat"s)), std::vector<int>({2, 1}));
+  server.RemoveDocument(2);
+  ASSERT_EQUAL(ids(server.FindTopDocuments("fluffy cat"s)), std::vector<int>({4, 1}));
+  ASSERT_EQUAL(ids(server.FindTopDocuments("fluffy cat"s)), std::vector<int>({4, 1}));
+  ASSERT_EQUAL(ids(copy.FindTopDocuments("fluffy cat"s)), std::vector<int>({2, 1}));
+
+  // копия делит кеш с сервером, но результаты разных поколений друг другу не выдаются
+  const auto stats = server.GetResultCache().GetStats();
+  ASSERT_EQUAL(stats.hits, 2u);
+  ASSERT_EQUAL(stats.hits, server.GetMetrics().GetSnapshot().GetCounter(Counter::CACHE_HITS));
+  ASSERT(stats.GetHitRate() > 0.0 && stats.GetHitRate() < 1.0);
+
+  SearchServer uncached("and"s, 2);
+  uncached.SetResultCacheCapacity(0);
+  for (const int id : server) {
+    uncached.AddDocument(id, id == 1 ? "white cat and fancy collar"s : id == 3 ? "groomed dog expressive eyes"s
+                                                                                : "fluffy parrot"s,
+                         id == 3 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {id});
+  }
+  const std::vector<std::string> queries = {"cat"s, "fluffy"s, "dog"s, "cat -collar"s, "parrot cat"s};
+  std::vector<std::thread> threads;
+  std::atomic<int> mismatch_count = 0;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < 200; ++j) {
+        const auto& query = queries[(i + j * j) % queries.size()];
+        const auto status = j % 3 ? DocumentStatus::ACTUAL : DocumentStatus::BANNED;
+        if (ids(server.FindTopDocuments(query, status)) != ids(uncached.FindTopDocuments(query, status)))
+          ++mismatch_count;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQUAL(mismatch_count.load(), 0);
+  // отключённый кеш не участвует в поиске
+  ASSERT_EQUAL(uncached.GetResultCache().GetStats().misses, 0u);
+  ASSERT_EQUAL(uncached.GetMetrics().GetSnapshot().GetCounter(Counter::CACHE_MISSES), 0u);
+}
+
+void TestRequestStatistics() {
+  using namespace std::chrono;
+  const auto start = RequestStatistics::Clock::now();
+  RequestStatistics statistics(seconds(64), start);
+
+  statistics.Record(microseconds(100), true, start + milliseconds(500));
+  statistics.Record(milliseconds(1), false, start + seconds(10));
+  auto stats = statistics.GetStats(start + seconds(20));
+  ASSERT_EQUAL(stats.request_count, 2u);
+  ASSERT_EQUAL(stats.empty_result_count, 1u);
+  ASSERT_EQUAL(stats.GetEmptyResultRate(), 0.5);
+  ASSERT(std::abs(stats.requests_per_second - 0.1) < 1e-9);
+  ASSERT(stats.latency.GetQuantile(0.5) >= 100'000u && stats.latency.GetQuantile(0.5) < 110'000u);
+  ASSERT(stats.latency.GetQuantile(1.0) >= 1'000'000u);
+
+  // первый интервал ушёл из окна, и его слот занимает новый
+  statistics.Record(microseconds(10), false, start + milliseconds(64'500));
+  stats = statistics.GetStats(start + seconds(70));
+  ASSERT_EQUAL(stats.request_count, 2u);
+  ASSERT_EQUAL(stats.empty_result_count, 0u);
+  ASSERT(std::abs(stats.requests_per_second - 2.0 / 64) < 1e-9);
+
+  // запись с опозданием больше окна отбрасывается
+  statistics.Record(microseconds(10), true, start + milliseconds(200));
+  ASSERT_EQUAL(statistics.GetStats(start + seconds(70)).empty_result_count, 0u);
+  ASSERT_EQUAL(statistics.GetStats(start + seconds(200)).request_count, 0u);
+
+  const auto now = start + seconds(300);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&statistics, now, i] {
+      for (int j = 0; j < 1000; ++j) {
+        statistics.Record(microseconds(j), j % 4 == 0, now + milliseconds(i * 1000 + j));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  stats = statistics.GetStats(now + seconds(10));
+  ASSERT_EQUAL(stats.request_count, 4000u);
+  ASSERT_EQUAL(stats.empty_result_count, 1000u);
+  ASSERT_EQUAL(stats.latency.count, 4000u);
+
+  // записи в интервал, который уже вытеснен из слота, не попадают в данные нового интервала
+  for (int round = 0; round < 50; ++round) {
+    RequestStatistics racing(seconds(64), start);
+    std::thread stale([&racing, start] {
+      for (int j = 0; j < 200; ++j) {
+        racing.Record(microseconds(1), true, start + milliseconds(500));
+      }
+    });
+    for (int j = 0; j < 200; ++j) {
+      racing.Record(microseconds(1), false, start + milliseconds(64'500));
+    }
+    stale.join();
+    const auto racing_stats = racing.GetStats(start + seconds(65));
+    ASSERT_EQUAL(racing_stats.request_count, 200u);
+    ASSERT_EQUAL(racing_stats.empty_result_count, 0u);
+    ASSERT_EQUAL(racing_stats.latency.count, 200u);
+  }
+
+  SearchServer server("and"s);
+  server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, {1});
+  server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::BANNED, {2});
+  RequestQueue request_queue(server);
+
+  std::vector<std::thread> clients;
+  for (int i = 0; i < 4; ++i) {
+    clients.emplace_back([&request_queue] {
+      for (int j = 0; j < 50; ++j) {
+        request_queue.AddFindRequest("cat"s);
+        request_queue.AddFindRequest("dog"s);
+        request_queue.AddFindRequest("fluffy"s, [](int, DocumentStatus status, int) {
+          return status == DocumentStatus::BANNED;
+        });
+      }
+    });
+  }
+  for (auto& client : clients) {
+    client.join();
+  }
+  ASSERT_EQUAL(request_queue.GetNoResultRequests(), 200);
+  ASSERT_EQUAL(request_queue.GetStatistics().request_count, 600u);
+  ASSERT(request_queue.GetStatistics().requests_per_second > 0.0);
+}
+
+void TestParseQueryDuplicates() {
+  SearchServer server("and"s);
+  server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, {1});
+  server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {2});
+  server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {3});
+
+  const std::string query = "cat fluffy cat and unknown fluffy"s;
+  const auto [words, status] = server.MatchDocument(query, 2);
+  ASSERT_EQUAL(words, (std::vector<std::string_view>{"cat"sv, "fluffy"sv}));
+
+  const auto [minus_words, minus_status] = server.MatchDocument("cat -fluffy -fluffy"s, 2);
+  ASSERT(minus_words.empty());
+
+  const auto found = server.FindTopDocuments("cat cat -collar -collar -unknown"s);
+  ASSERT_EQUAL(found.size(), 1u);
+  ASSERT_EQUAL(found[0].id, 2);
+  ASSERT_EQUAL(server.FindTopDocuments("cat"s)[0].relevance, found[0].relevance);
+
+  bool thrown = false;
+  try {
+    server.FindTopDocuments("cat --fluffy"s);
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  ASSERT_HINT(thrown, "Double minus must be rejected"s);
+}
+
+void TestTermDictionary() {
+  auto dictionary = std::make_unique<TermDictionary>();
+  const std::string long_word(100'000, 'x');
+
+  ASSERT_EQUAL(dictionary->Add("cat"sv), 0u);
+  ASSERT_EQUAL(dictionary->Add("dog"sv), 1u);
+  ASSERT_EQUAL(dictionary->Add("cat"sv), 0u);
+  ASSERT_EQUAL(dictionary->Add(long_word), 2u);
+  ASSERT_EQUAL(dictionary->Find("dog"sv), 1u);
+  ASSERT_EQUAL(dictionary->Find("horse"sv), TermDictionary::NO_TERM);
+
+  const TermDictionary copy = *dictionary;
+  dictionary.reset();
+
+  ASSERT_EQUAL(copy.size(), 3u);
+  ASSERT_EQUAL(copy.GetWord(0), "cat"sv);
+  ASSERT_EQUAL(copy.GetWord(2), std::string_view(long_word));
+  ASSERT_EQUAL(copy.Find("dog"sv), 1u);
+}
+
+void TestThreadPool() {
+  ThreadPool thread_pool(4);
+  ASSERT_EQUAL(thread_pool.GetConcurrency(), 4u);
+
+  std::vector<int> values(1000);
+  thread_pool.ParallelFor(values.size(), [&values](size_t i) {
+    values[i] = static_cast<int>(i);
+  });
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQUAL(values[i], static_cast<int>(i));
+  }
+
+  std::atomic<int> nested_count = 0;
+  thread_pool.ParallelFor(8, [&thread_pool, &nested_count](size_t) {
+    thread_pool.ParallelFor(8, [&nested_count](size_t) {
+      ++nested_count;
+    });
+  });
+  ASSERT_EQUAL(nested_count.load(), 64);
+
+  bool thrown = false;
+  try {
+    thread_pool.ParallelFor(100, [](size_t i) {
+      if (i == 42)
+        throw std::runtime_error("task failed"s);
+    });
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  ASSERT_HINT(thrown, "Exception from a task must reach the caller"s);
+}
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer() {
   RUN_TEST(TestAddDocument);
@@ -232,6 +1299,29 @@ void TestSearchServer() {
   RUN_TEST(TestUserPredicate);
   RUN_TEST(TestSearchSpecifiedStatusDoc);
   RUN_TEST(TestComputeRelevance);
+  RUN_TEST(TestRelevanceFollowsIndexChanges);
   RUN_TEST(TestRemoveDuplicates);
+  RUN_TEST(TestGetWordFrequencies);
+  RUN_TEST(TestFindDuplicates);
+  RUN_TEST(TestRemoveDocument);
+  RUN_TEST(TestFindTopDocumentsResultCount);
+  RUN_TEST(TestFindTopDocumentsSharded);
+  RUN_TEST(TestSplitIntoWords);
+  RUN_TEST(TestParseQueryDuplicates);
+  RUN_TEST(TestNestedSearchInPredicate);
+  RUN_TEST(TestAddDocuments);
+  RUN_TEST(TestSaveAndOpenIndex);
+  RUN_TEST(TestRemoveDocumentsCompaction);
+  RUN_TEST(TestSnapshotSearchServer);
+  RUN_TEST(TestFindTopDocumentsBatch);
+  RUN_TEST(TestProcessQueriesJoinedLazy);
+  RUN_TEST(TestFindTopDocumentsMaxScore);
+  RUN_TEST(TestStatusAndRatingAfterCompaction);
+  RUN_TEST(TestMatchDocuments);
+  RUN_TEST(TestMetrics);
+  RUN_TEST(TestQueryResultCache);
+  RUN_TEST(TestRequestStatistics);
+  RUN_TEST(TestTermDictionary);
+  RUN_TEST(TestThreadPool);
   //TestParrallelFindDoc();
 }
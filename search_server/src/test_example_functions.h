@@ -1,14 +1,23 @@
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 #include <iostream>
 #include <map>
 #include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "binary_io.h"
+#include "process_queries.h"
+#include "request_queue.h"
 #include "search_server.h"
+#include "snapshot_search_server.h"
+#include "term_dictionary.h"
+#include "thread_pool.h"
 
 #define RUN_TEST(func) RunTestImpl((func), #func)
 #define ASSERT_EQUAL(a, b) AssertEqualImpl((a), (b), #a, #b, __FILE__, __FUNCTION__, __LINE__, ""s)
@@ -44,6 +53,30 @@ void AssertEqualImpl(const T& t, const U& u, const std::string& t_str, const std
 void AssertImpl(bool value, const std::string& expr_str, const std::string& file,
                 const std::string& func, unsigned line, const std::string& hint);
 
+// Файл индекса, разобранный по полям в порядке SaveIndex. Тесты портят отдельные поля
+// и собирают файл заново, не завися от смещений внутри формата
+struct IndexImage {
+  std::string magic;
+  uint32_t version = 0;
+  std::vector<std::string> stop_words;
+  std::vector<int> ordinal_to_document_id;
+  std::vector<std::pair<std::string, PostingList>> terms;
+  std::vector<std::vector<TermFrequency>> ordinal_to_term_freqs;
+  std::vector<int> document_ids;
+  std::vector<int> ratings;
+  std::vector<DocumentStatus> statuses;
+  std::vector<uint64_t> ordinals;
+  std::vector<uint64_t> fingerprints;
+};
+
+IndexImage ReadIndexImage(const std::string& data);
+
+std::string WriteIndexImage(const IndexImage& image);
+
+// Сравнивает выдачу поиска по документам: id, рейтинг и релевантность с точностью relevance_tolerance
+void AssertSameDocuments(const std::vector<Document>& found, const std::vector<Document>& expected,
+                         double relevance_tolerance = RELEVANCE_EPSILON);
+
 void TestAddDocument();
 void TestExcludeStopWordsFromAddedDocumentContent();
 void TestExcludeMinusWordsFromAddedDocumentContent();
@@ -53,8 +86,31 @@ void TestComputeDocumentRating();
 void TestUserPredicate();
 void TestSearchSpecifiedStatusDoc();
 void TestComputeRelevance();
+void TestRelevanceFollowsIndexChanges();
 void TestRemoveDuplicates();
 void TestParrallelFindDoc();
+void TestGetWordFrequencies();
+void TestFindDuplicates();
+void TestRemoveDocument();
+void TestFindTopDocumentsResultCount();
+void TestFindTopDocumentsSharded();
+void TestSplitIntoWords();
+void TestParseQueryDuplicates();
+void TestNestedSearchInPredicate();
+void TestAddDocuments();
+void TestSaveAndOpenIndex();
+void TestRemoveDocumentsCompaction();
+void TestSnapshotSearchServer();
+void TestFindTopDocumentsBatch();
+void TestProcessQueriesJoinedLazy();
+void TestFindTopDocumentsMaxScore();
+void TestStatusAndRatingAfterCompaction();
+void TestMatchDocuments();
+void TestMetrics();
+void TestQueryResultCache();
+void TestRequestStatistics();
+void TestTermDictionary();
+void TestThreadPool();
 
 void TestSearchServer();
 
@@ -0,0 +1,5 @@
+#include "test_example_functions.h"
+
+int main() {
+    TestSearchServer();
+}
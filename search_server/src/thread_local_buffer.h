@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Буфер из стека буферов типа T текущего потока. Буферы переиспользуются между вызовами, поэтому
+// после прогрева память не выделяется. Поиск может вложиться в другой поиск на том же потоке:
+// предикат пользователя вызывается посреди подсчёта и сам запускает поиск, в том числе на потоке
+// пула, выполняющем часть ParallelFor. Каждый уровень вложенности получает свой буфер, поэтому
+// вложенный вызов не портит внешний
+template<typename T>
+class ThreadLocalBuffer {
+ public:
+  ThreadLocalBuffer()
+      : depth_(GetDepth()) {
+    auto& buffers = GetBuffers();
+    if (buffers.size() == depth_)
+      buffers.push_back(std::make_unique<T>());
+    buffer_ = buffers[depth_].get();
+    ++GetDepth();
+  }
+
+  ThreadLocalBuffer(const ThreadLocalBuffer&) = delete;
+  ThreadLocalBuffer& operator=(const ThreadLocalBuffer&) = delete;
+
+  ~ThreadLocalBuffer() {
+    --GetDepth();
+  }
+
+  T& operator*() const noexcept {
+    return *buffer_;
+  }
+
+  T* operator->() const noexcept {
+    return buffer_;
+  }
+
+ private:
+  size_t depth_;
+  T* buffer_;
+
+  static std::vector<std::unique_ptr<T>>& GetBuffers() {
+    static thread_local std::vector<std::unique_ptr<T>> buffers;
+    return buffers;
+  }
+
+  static size_t& GetDepth() {
+    static thread_local size_t depth = 0;
+    return depth;
+  }
+};
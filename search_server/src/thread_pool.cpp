@@ -0,0 +1,118 @@
+#include "thread_pool.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t concurrency) {
+  if (concurrency == 0)
+    concurrency = max<size_t>(thread::hardware_concurrency(), 1);
+
+  const size_t worker_count = concurrency - 1;
+  for (size_t i = 0; i < worker_count; ++i) {
+    queues_.push_back(make_unique<TaskQueue>());
+  }
+
+  workers_.reserve(worker_count);
+  for (size_t i = 0; i < worker_count; ++i) {
+    workers_.emplace_back([this, i] {
+      WorkerLoop(i);
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard lock(sleep_mutex_);
+    stop_ = true;
+  }
+  wake_up_.notify_all();
+
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Submit(function<void()> task) {
+  if (workers_.empty()) {
+    task();
+    return;
+  }
+
+  auto& queue = *queues_[next_queue_++ % queues_.size()];
+  {
+    lock_guard lock(queue.mutex);
+    queue.tasks.push_back(move(task));
+  }
+  {
+    lock_guard lock(sleep_mutex_);
+    ++pending_count_;
+  }
+  wake_up_.notify_one();
+}
+
+bool ThreadPool::TryPop(size_t worker_index, function<void()>& task) {
+  // свою очередь разбираем с конца, у остальных крадём с начала
+  {
+    auto& own = *queues_[worker_index];
+    lock_guard lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  for (size_t shift = 1; shift < queues_.size(); ++shift) {
+    auto& victim = *queues_[(worker_index + shift) % queues_.size()];
+    lock_guard lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::WorkerLoop(size_t worker_index) {
+  while (true) {
+    function<void()> task;
+    if (TryPop(worker_index, task)) {
+      --pending_count_;
+      task();
+      continue;
+    }
+
+    unique_lock lock(sleep_mutex_);
+    wake_up_.wait(lock, [this] {
+      return stop_ || pending_count_ > 0;
+    });
+
+    if (stop_ && pending_count_ == 0)
+      return;
+  }
+}
+
+void ThreadPool::ParallelForState::Run() {
+  while (true) {
+    const size_t begin = next_index.fetch_add(grain);
+    if (begin >= count)
+      return;
+
+    const size_t end = min(begin + grain, count);
+    try {
+      for (size_t i = begin; i < end; ++i) {
+        function(i);
+      }
+    } catch (...) {
+      lock_guard lock(mutex);
+      if (!exception)
+        exception = current_exception();
+    }
+
+    if (done_count.fetch_add(end - begin) + (end - begin) == count) {
+      lock_guard lock(mutex);
+      finished.notify_all();
+    }
+  }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с очередью задач у каждого рабочего потока.
+// Свободный поток сначала берёт задачи из своей очереди, затем крадёт из чужих
+class ThreadPool {
+ public:
+  // concurrency — общее число потоков, выполняющих ParallelFor, включая вызывающий;
+  // 0 означает число аппаратных потоков
+  explicit ThreadPool(size_t concurrency = 0);
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool();
+
+  size_t GetConcurrency() const noexcept {
+    return workers_.size() + 1;
+  }
+
+  void Submit(std::function<void()> task);
+
+  // Выполняет function(i) для всех i из [0, count) и дожидается завершения.
+  // Вызывающий поток тоже берёт работу, поэтому вложенные вызовы не блокируют пул.
+  // Первое выброшенное исключение пробрасывается вызывающему
+  template<typename Function>
+  void ParallelFor(size_t count, Function function);
+
+ private:
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  struct ParallelForState {
+    std::function<void(size_t)> function;
+    size_t count = 0;
+    size_t grain = 1;
+    std::atomic<size_t> next_index = 0;
+    std::atomic<size_t> done_count = 0;
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr exception;
+
+    void Run();
+  };
+
+  std::vector<std::unique_ptr<TaskQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> next_queue_ = 0;
+  std::atomic<size_t> pending_count_ = 0;
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_up_;
+  bool stop_ = false;
+
+  bool TryPop(size_t worker_index, std::function<void()>& task);
+
+  void WorkerLoop(size_t worker_index);
+};
+
+template<typename Function>
+void ThreadPool::ParallelFor(size_t count, Function function) {
+  if (count == 0)
+    return;
+
+  if (workers_.empty() || count == 1) {
+    for (size_t i = 0; i < count; ++i) {
+      function(i);
+    }
+    return;
+  }
+
+  auto state = std::make_shared<ParallelForState>();
+  state->function = std::ref(function);
+  state->count = count;
+  state->grain = std::max<size_t>(count / (GetConcurrency() * 4), 1);
+
+  const size_t helper_count = std::min(workers_.size(), (count + state->grain - 1) / state->grain - 1);
+  for (size_t i = 0; i < helper_count; ++i) {
+    Submit([state] {
+      state->Run();
+    });
+  }
+
+  state->Run();
+
+  std::unique_lock lock(state->mutex);
+  state->finished.wait(lock, [&state] {
+    return state->done_count == state->count;
+  });
+
+  if (state->exception)
+    std::rethrow_exception(state->exception);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+
+constexpr double RELEVANCE_EPSILON = 1e-6;
+
+// Порядок выдачи: по убыванию релевантности, затем рейтинга, затем по возрастанию id
+inline bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+  if (std::abs(lhs.relevance - rhs.relevance) >= RELEVANCE_EPSILON) {
+    return lhs.relevance > rhs.relevance;
+  }
+  if (lhs.rating != rhs.rating) {
+    return lhs.rating > rhs.rating;
+  }
+  return lhs.id < rhs.id;
+}
+
+// Хранит не более max_count самых релевантных документов из добавленных.
+// Куча упорядочена так, что в её вершине лежит наименее релевантный документ
+class TopDocuments {
+ public:
+  explicit TopDocuments(size_t max_count)
+      : max_count_(max_count) {
+    // max_count задаёт вызывающий, и он может быть сколь угодно большим, а подходящих документов
+    // обычно мало, поэтому заранее выделяется не больше INITIAL_CAPACITY мест
+    heap_.reserve(std::min(max_count_, INITIAL_CAPACITY));
+  }
+
+  void Add(const Document& document) {
+    if (heap_.size() < max_count_) {
+      heap_.push_back(document);
+      std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    } else if (max_count_ > 0 && IsMoreRelevant(document, heap_.front())) {
+      std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+      heap_.back() = document;
+      std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    }
+  }
+
+  size_t GetMaxCount() const noexcept {
+    return max_count_;
+  }
+
+  bool IsFull() const noexcept {
+    return heap_.size() >= max_count_;
+  }
+
+  // Релевантность наименее релевантного из накопленных; куча не должна быть пустой.
+  // Документ с релевантностью меньше неё более чем на RELEVANCE_EPSILON уже не попадёт в результат
+  double GetWorstRelevance() const {
+    return heap_.front().relevance;
+  }
+
+  // Возвращает накопленные документы в порядке выдачи
+  std::vector<Document> Extract() {
+    std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    return std::move(heap_);
+  }
+
+ private:
+  static constexpr size_t INITIAL_CAPACITY = 64;
+
+  size_t max_count_;
+  std::vector<Document> heap_;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "inverted_index.h"
+
+struct TermFrequency {
+  InvertedIndex::TermId term;
+  double term_freq;
+};
+
+// Невладеющее представление частот слов документа. Слова перечисляются по алфавиту.
+// Действительно, пока документ не удалён из поискового сервера
+class WordFrequenciesView {
+ public:
+  class Iterator {
+   public:
+    // разыменование возвращает пару по значению, поэтому итератор может быть только итератором ввода
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::pair<std::string_view, double>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    Iterator() = default;
+
+    Iterator(const InvertedIndex* index, const TermFrequency* position)
+        : index_(index),
+          position_(position) {
+    }
+
+    value_type operator*() const {
+      return {index_->GetWord(position_->term), position_->term_freq};
+    }
+
+    Iterator& operator++() {
+      ++position_;
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator copy = *this;
+      ++position_;
+      return copy;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return position_ == other.position_;
+    }
+
+    bool operator!=(const Iterator& other) const {
+      return position_ != other.position_;
+    }
+
+   private:
+    const InvertedIndex* index_ = nullptr;
+    const TermFrequency* position_ = nullptr;
+  };
+
+  WordFrequenciesView() = default;
+
+  WordFrequenciesView(const InvertedIndex& index, const std::vector<TermFrequency>& terms)
+      : index_(&index),
+        begin_(terms.data()),
+        end_(terms.data() + terms.size()) {
+  }
+
+  Iterator begin() const noexcept {
+    return {index_, begin_};
+  }
+
+  Iterator end() const noexcept {
+    return {index_, end_};
+  }
+
+  size_t size() const noexcept {
+    return end_ - begin_;
+  }
+
+  bool empty() const noexcept {
+    return begin_ == end_;
+  }
+
+ private:
+  const InvertedIndex* index_ = nullptr;
+  const TermFrequency* begin_ = nullptr;
+  const TermFrequency* end_ = nullptr;
+};